@@ -1,16 +1,35 @@
 #pragma once
 #include <tga/tga.hpp>
 #include <tga/tga_math.hpp>
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
 #include "perlinNoise.hpp"
 
-struct Voxel {
-    int type; // 0: empty, 1: dirt, 2: grass, etc.
-    bool visible; // If the voxel is exposed to air.
-    bool isSource = false;          // True if this voxel is a source block
+using BlockID = uint8_t; // 0: empty, 1: grass, 2: stone, etc.
+
+// Per-voxel state that only fluids and falling blocks need. Stored sparsely
+// next to the block IDs; a voxel without an entry uses defaultFor(type).
+struct VoxelMeta {
+    bool isSource = false;       // True if this voxel is a source block
     int sourceID = -1;           // ID of the source block that created this water
     int tickCounter = 0;
-    bool faceVisible[6];
-    bool updated = true;
+    uint8_t faceMask = 0;        // Bit i set if face i is exposed (+x, -x, +y, -y, +z, -z)
+
+    // Untouched terrain water is an untracked source, everything else starts empty
+    static VoxelMeta defaultFor(int type) {
+        VoxelMeta meta;
+        meta.isSource = (type == 9);
+        return meta;
+    }
+
+    bool operator==(const VoxelMeta& other) const {
+        return isSource == other.isSource && sourceID == other.sourceID &&
+               tickCounter == other.tickCounter && faceMask == other.faceMask;
+    }
 };
 
 // Helper for 2D chunk coordinate keys
@@ -22,33 +41,351 @@ struct ChunkKey {
     }
 };
 
-// Custom hash for ChunkKey to use in unordered_map
+// Custom hash for ChunkKey to use in unordered_map. Packs both coordinates into
+// one 64-bit value and runs the splitmix64 finaliser over it, so keys with x == z
+// or mirrored coordinates no longer collide.
 struct ChunkKeyHasher {
     std::size_t operator()(const ChunkKey& key) const {
-        return std::hash<int>()(key.x) ^ std::hash<int>()(key.z);
+        uint64_t h = (uint64_t(uint32_t(key.x)) << 32) | uint32_t(key.z);
+        h = (h ^ (h >> 30)) * 0xbf58476d1ce4e5b9ULL;
+        h = (h ^ (h >> 27)) * 0x94d049bb133111ebULL;
+        return static_cast<std::size_t>(h ^ (h >> 31));
     }
 };
 
 constexpr int CHUNK_SIZE = 16;
+constexpr int CHUNK_SHIFT = 4;              // World x/z >> CHUNK_SHIFT gives the chunk coordinate
+constexpr int CHUNK_MASK = CHUNK_SIZE - 1;  // World x/z & CHUNK_MASK gives the local coordinate
+static_assert(CHUNK_SIZE == 1 << CHUNK_SHIFT, "CHUNK_SIZE must be a power of two");
 constexpr int CHUNK_SIZE_Y = 48;
+constexpr int CHUNK_VOLUME = CHUNK_SIZE * CHUNK_SIZE_Y * CHUNK_SIZE;
+constexpr int SECTION_HEIGHT = 16;
+constexpr int CHUNK_SECTIONS = CHUNK_SIZE_Y / SECTION_HEIGHT;
+constexpr int SECTION_VOLUME = CHUNK_SIZE * SECTION_HEIGHT * CHUNK_SIZE;
+constexpr int MAX_CHUNK_LOD = 3; // Coarsest chunk mesh level, 8x8x8 voxels per cell
+
+// Solid blocks (everything but air and water)
+inline bool isOpaqueType(int type) {
+    return type != 0 && type != 9;
+}
+
+// Blocks that hide the faces of their neighbours. Leaves are solid but can be
+// seen through, so the faces behind them are kept.
+inline bool hidesNeighbourFaces(int type) {
+    return isOpaqueType(type) && type != 6;
+}
+
+inline bool isFluidType(int type) {
+    return type == 9;
+}
+
+// How a block's faces are drawn. Chunk meshes keep one sub-mesh per layer and the
+// layers are drawn in this order, each with its own blend state.
+enum class RenderLayer : uint8_t {
+    Opaque,      // No blending, keeps early depth rejection
+    AlphaTested, // Leaves: texels below half alpha are discarded, no blending
+    Translucent  // Water: blended, drawn last and back to front by chunk
+};
+constexpr int RENDER_LAYER_COUNT = 3;
+
+inline RenderLayer renderLayerOf(int type) {
+    if (type == 6) return RenderLayer::AlphaTested;
+    if (type == 9) return RenderLayer::Translucent;
+    return RenderLayer::Opaque;
+}
+
+// Ores that are drawn even when fully enclosed (diamond and gold)
+inline bool isAlwaysVisibleType(int type) {
+    return type == 4 || type == 14;
+}
+
+// Which faces of a section see each other through cells light could pass: bit b of
+// reachable[a] is set when such a path joins face a to face b. Faces are in the
+// mesher's order (+x, -x, +y, -y, +z, -z).
+struct SectionConnectivity {
+    std::array<uint8_t, 6> reachable{};
+
+    bool connects(int from, int to) const { return (reachable[from] >> to) & 1u; }
+
+    static SectionConnectivity all() {
+        SectionConnectivity connectivity;
+        connectivity.reachable.fill(0x3F);
+        return connectivity;
+    }
+};
+
+// One bit per voxel in Chunk::index order. Word y * 4 + z / 4 holds the four
+// 16-voxel x-rows z..z+3 of layer y, bit (z % 4) * 16 + x.
+using VoxelMask = std::array<uint64_t, CHUNK_VOLUME / 64>;
+
+// A 16x16x16 slice of a chunk stored as a small palette of block IDs plus
+// bit-packed palette indices. Entries never straddle a 64-bit word since the
+// index width is always 1, 2, 4 or 8 bits. The palette grows on demand.
+// A uniform section (single palette entry) stores no index array at all.
+class ChunkSection {
+public:
+    BlockID get(int i) const {
+        if (bitsPerEntry == 0) return palette[0];
+        int bit = i * bitsPerEntry;
+        uint64_t mask = (uint64_t(1) << bitsPerEntry) - 1;
+        return palette[(data[bit >> 6] >> (bit & 63)) & mask];
+    }
+
+    void set(int i, BlockID type) {
+        if (bitsPerEntry == 0 && palette[0] == type) return;
+        int paletteIndex = findInPalette(type);
+        if (paletteIndex < 0) {
+            paletteIndex = static_cast<int>(palette.size());
+            palette.push_back(type);
+            if (palette.size() > (size_t(1) << bitsPerEntry)) {
+                repack(bitsFor(palette.size()));
+            }
+        }
+        writeIndex(i, paletteIndex);
+    }
+
+    // Drops palette entries that are no longer referenced and shrinks the index width
+    void optimize() {
+        std::array<bool, 256> used{};
+        for (int i = 0; i < SECTION_VOLUME; ++i) {
+            used[get(i)] = true;
+        }
+        std::vector<BlockID> compacted;
+        for (BlockID type : palette) {
+            if (used[type]) compacted.push_back(type);
+        }
+        if (compacted.size() == palette.size()) return;
+
+        std::array<BlockID, SECTION_VOLUME> types;
+        for (int i = 0; i < SECTION_VOLUME; ++i) {
+            types[i] = get(i);
+        }
+        palette = std::move(compacted);
+        bitsPerEntry = bitsFor(palette.size());
+        if (bitsPerEntry == 0) {
+            std::vector<uint64_t>().swap(data); // Release the index array
+            return;
+        }
+        data.assign(SECTION_VOLUME * bitsPerEntry / 64, 0);
+        for (int i = 0; i < SECTION_VOLUME; ++i) {
+            writeIndex(i, findInPalette(types[i]));
+        }
+    }
+
+    size_t paletteSize() const { return palette.size(); }
+
+    bool isUniform() const { return bitsPerEntry == 0; }
+    BlockID uniformType() const { return palette[0]; }
+    bool isEmpty() const { return isUniform() && palette[0] == 0; }
+    bool isSolid() const { return isUniform() && isOpaqueType(palette[0]); }
+
+    // May report types that were since overwritten until the next optimize()
+    bool mayContain(BlockID type) const { return findInPalette(type) >= 0; }
+
+    size_t memoryUsage() const {
+        return sizeof(ChunkSection) + palette.capacity() * sizeof(BlockID) + data.capacity() * sizeof(uint64_t);
+    }
+
+private:
+    static int bitsFor(size_t paletteSize) {
+        if (paletteSize <= 1) return 0;
+        int bits = 1;
+        while ((size_t(1) << bits) < paletteSize) bits *= 2;
+        return bits;
+    }
+
+    int findInPalette(BlockID type) const {
+        for (size_t p = 0; p < palette.size(); ++p) {
+            if (palette[p] == type) return static_cast<int>(p);
+        }
+        return -1;
+    }
+
+    void writeIndex(int i, int paletteIndex) {
+        int bit = i * bitsPerEntry;
+        uint64_t mask = ((uint64_t(1) << bitsPerEntry) - 1) << (bit & 63);
+        uint64_t& word = data[bit >> 6];
+        word = (word & ~mask) | ((uint64_t(paletteIndex) << (bit & 63)) & mask);
+    }
+
+    void repack(int newBits) {
+        std::vector<uint64_t> old = std::move(data);
+        int oldBits = bitsPerEntry;
+        uint64_t oldMask = (uint64_t(1) << oldBits) - 1;
+        bitsPerEntry = newBits;
+        data.assign(SECTION_VOLUME * bitsPerEntry / 64, 0);
+        if (oldBits == 0) return; // Every voxel referenced palette entry 0
+        for (int i = 0; i < SECTION_VOLUME; ++i) {
+            int bit = i * oldBits;
+            writeIndex(i, static_cast<int>((old[bit >> 6] >> (bit & 63)) & oldMask));
+        }
+    }
+
+    std::vector<BlockID> palette{0}; // Starts as uniform air
+    std::vector<uint64_t> data;
+    int bitsPerEntry = 0;
+};
 
 
 class Chunk {
 
 public:
-    Voxel voxels[CHUNK_SIZE][CHUNK_SIZE_Y][CHUNK_SIZE];
     glm::vec3 position; // Position of the chunk in world coordinates
-    ChunkKey key; 
-    bool isGenerated;
-    bool isDirty;
+    ChunkKey key;
+    bool isGenerated = false;
+    bool isDirty = false;
+
+    static bool inBounds(int x, int y, int z) {
+        return x >= 0 && x < CHUNK_SIZE && y >= 0 && y < CHUNK_SIZE_Y && z >= 0 && z < CHUNK_SIZE;
+    }
+
+    // x runs fastest so a row of CHUNK_SIZE voxels along x is contiguous
+    static int index(int x, int y, int z) {
+        return (y * CHUNK_SIZE + z) * CHUNK_SIZE + x;
+    }
+
+    BlockID getType(int x, int y, int z) const {
+        int i = index(x, y, z);
+        return sections[i / SECTION_VOLUME].get(i % SECTION_VOLUME);
+    }
+
+    // Changing the type drops any fluid/tick state the voxel carried
+    void setType(int x, int y, int z, int type) {
+        int i = index(x, y, z);
+        ChunkSection& section = sections[i / SECTION_VOLUME];
+        if (section.get(i % SECTION_VOLUME) != type) {
+            section.set(i % SECTION_VOLUME, static_cast<BlockID>(type));
+            metadata.erase(static_cast<uint16_t>(i));
+            assignBit(opaqueBits, i, isOpaqueType(type));
+            assignBit(hidingBits, i, hidesNeighbourFaces(type));
+            assignBit(airBits, i, type == 0);
+            assignBit(alwaysVisibleBits, i, isAlwaysVisibleType(type));
+            if (testBit(fluidBits, i) != isFluidType(type)) {
+                assignBit(fluidBits, i, isFluidType(type));
+                fluidCounts[i / SECTION_VOLUME] += isFluidType(type) ? 1 : -1;
+            }
+            updateHeightmaps(x, y, z);
+            staleConnectivity |= 1u << (i / SECTION_VOLUME);
+        }
+    }
+
+    // Column heights, -1 when the column has no such block
+    int highestBlock(int x, int z) const { return highestBlockMap[z * CHUNK_SIZE + x]; }   // Any non-air block, water included
+    int highestSolid(int x, int z) const { return highestSolidMap[z * CHUNK_SIZE + x]; }   // Non-air, non-water
+    int highestClearGround(int x, int z) const { return clearGroundMap[z * CHUNK_SIZE + x]; } // Solid with two air blocks above
+
+    bool isClearGround(int x, int y, int z) const {
+        return y >= 0 && y + 2 < CHUNK_SIZE_Y && testBit(opaqueBits, index(x, y, z)) &&
+               testBit(airBits, index(x, y + 1, z)) && testBit(airBits, index(x, y + 2, z));
+    }
+
+    // Occupancy masks kept in sync by setType, for word-parallel neighbour tests
+    const VoxelMask& opaqueMask() const { return opaqueBits; }
+    const VoxelMask& hidingMask() const { return hidingBits; } // Opaque and not see-through
+    const VoxelMask& airMask() const { return airBits; }
+    const VoxelMask& alwaysVisibleMask() const { return alwaysVisibleBits; }
+
+    // Index of the fluid cells, so water passes visit only those instead of every voxel
+    const VoxelMask& fluidMask() const { return fluidBits; }
+    int fluidCount(int s) const { return fluidCounts[s]; }
+    bool hasFluid() const {
+        for (int count : fluidCounts) {
+            if (count > 0) return true;
+        }
+        return false;
+    }
+
+    const VoxelMask& visibleMask() const { return visibleBits; }
+
+    // Replaces every visibility bit at once and recounts the sections
+    void setVisibleMask(const VoxelMask& mask) {
+        visibleBits = mask;
+        constexpr int wordsPerSection = SECTION_VOLUME / 64;
+        for (int s = 0; s < CHUNK_SECTIONS; ++s) {
+            int count = 0;
+            for (int w = s * wordsPerSection; w < (s + 1) * wordsPerSection; ++w) {
+                count += std::popcount(mask[w]);
+            }
+            visibleCounts[s] = count;
+        }
+    }
+
+    bool isVisible(int x, int y, int z) const {
+        return testBit(visibleBits, index(x, y, z));
+    }
+
+    void setVisible(int x, int y, int z, bool visible) {
+        int i = index(x, y, z);
+        if (testBit(visibleBits, i) != visible) {
+            assignBit(visibleBits, i, visible);
+            visibleCounts[i / SECTION_VOLUME] += visible ? 1 : -1;
+        }
+    }
+
+    const ChunkSection& section(int s) const { return sections[s]; }
+
+    // Face connectivity of a section, recomputed on first use after setType changed it.
+    // Not thread safe; only the main thread asks for it.
+    const SectionConnectivity& connectivity(int s) const {
+        if (staleConnectivity & (1u << s)) {
+            sectionConnectivity[s] = computeConnectivity(s);
+            staleConnectivity &= ~(1u << s);
+        }
+        return sectionConnectivity[s];
+    }
+
+    // Number of visible voxels in a section; zero means the section produces no geometry
+    int visibleCount(int s) const { return visibleCounts[s]; }
+
+    bool isUpdated(int x, int y, int z) const {
+        return testBit(updatedBits, index(x, y, z));
+    }
+
+    void setUpdated(int x, int y, int z, bool updated) {
+        assignBit(updatedBits, index(x, y, z), updated);
+    }
+
+    VoxelMeta getMeta(int x, int y, int z) const {
+        int i = index(x, y, z);
+        auto it = metadata.find(static_cast<uint16_t>(i));
+        return it != metadata.end() ? it->second : VoxelMeta::defaultFor(getType(x, y, z));
+    }
+
+    // Entries equal to the type's default are not stored
+    void setMeta(int x, int y, int z, const VoxelMeta& meta) {
+        int i = index(x, y, z);
+        if (meta == VoxelMeta::defaultFor(getType(x, y, z))) {
+            metadata.erase(static_cast<uint16_t>(i));
+        } else {
+            metadata[static_cast<uint16_t>(i)] = meta;
+        }
+    }
+
+    size_t metadataCount() const { return metadata.size(); }
+
+    // Shrinks section palettes after bulk edits such as terrain generation
+    void optimizeSections() {
+        for (ChunkSection& section : sections) {
+            section.optimize();
+        }
+    }
+
+    // Approximate resident size of the chunk in bytes
+    size_t memoryUsage() const {
+        size_t bytes = sizeof(Chunk) + metadata.size() * (sizeof(uint16_t) + sizeof(VoxelMeta) + 2 * sizeof(void*));
+        for (const ChunkSection& section : sections) {
+            bytes += section.memoryUsage() - sizeof(ChunkSection);
+        }
+        return bytes;
+    }
 
     // Retrieves the type of a voxel at local chunk-relative coordinates
     int getVoxelType(int x, int y, int z) const {
-        if (x < 0 || x >= CHUNK_SIZE || y < 0 || y >= CHUNK_SIZE_Y || z < 0 || z >= CHUNK_SIZE) {
+        if (!inBounds(x, y, z)) {
             // Out of bounds
             return 0; // Assume empty if out of bounds
         }
-        return voxels[x][y][z].type;
+        return getType(x, y, z);
     }
 
     // Retrieves the type of a voxel at world-relative coordinates
@@ -60,4 +397,107 @@ public:
 
         return getVoxelType(x, y, z);
     }
+
+private:
+    using Heightmap = std::array<int8_t, CHUNK_SIZE * CHUNK_SIZE>;
+
+    // Flood fills the cells that do not block sight (air, water, leaves) and
+    // connects every pair of faces one filled region touches
+    SectionConnectivity computeConnectivity(int s) const;
+
+    // Keeps the column heights current after the voxel at (x, y, z) changed type.
+    // Only lowering the current top of a column needs a scan down the column.
+    void updateHeightmaps(int x, int y, int z) {
+        int column = z * CHUNK_SIZE + x;
+        auto track = [&](int8_t& height, int at, bool present, auto&& test) {
+            if (present && at > height) {
+                height = static_cast<int8_t>(at);
+            } else if (!present && at == height) {
+                height = -1;
+                for (int below = at - 1; below >= 0; --below) {
+                    if (test(below)) { height = static_cast<int8_t>(below); break; }
+                }
+            }
+        };
+        auto nonAir = [&](int h) { return !testBit(airBits, index(x, h, z)); };
+        auto solid = [&](int h) { return testBit(opaqueBits, index(x, h, z)); };
+        auto clear = [&](int h) { return isClearGround(x, h, z); };
+
+        track(highestBlockMap[column], y, nonAir(y), nonAir);
+        track(highestSolidMap[column], y, solid(y), solid);
+
+        // A change at y can only affect the clearance of the blocks at y - 2 .. y
+        int8_t& ground = clearGroundMap[column];
+        int previous = ground;
+        bool lostTop = false;
+        for (int h = std::max(y - 2, 0); h <= y; ++h) {
+            bool ok = clear(h);
+            if (ok && h > ground) ground = static_cast<int8_t>(h);
+            else if (!ok && h == previous) lostTop = true;
+        }
+        if (lostTop && ground == previous) {
+            track(ground, previous, false, clear);
+        }
+    }
+
+    static bool testBit(const VoxelMask& bits, int i) {
+        return (bits[i >> 6] >> (i & 63)) & 1u;
+    }
+
+    static void assignBit(VoxelMask& bits, int i, bool value) {
+        uint64_t mask = uint64_t(1) << (i & 63);
+        bits[i >> 6] = value ? (bits[i >> 6] | mask) : (bits[i >> 6] & ~mask);
+    }
+
+    std::array<ChunkSection, CHUNK_SECTIONS> sections;
+    std::array<int, CHUNK_SECTIONS> visibleCounts{};
+    VoxelMask visibleBits{};
+    VoxelMask updatedBits{};
+    VoxelMask opaqueBits{};
+    VoxelMask hidingBits{};
+    VoxelMask airBits = [] { VoxelMask m; m.fill(~uint64_t(0)); return m; }(); // Starts as all air
+    VoxelMask alwaysVisibleBits{};
+    VoxelMask fluidBits{};
+    std::array<int, CHUNK_SECTIONS> fluidCounts{};
+    Heightmap highestBlockMap = [] { Heightmap h; h.fill(-1); return h; }();
+    Heightmap highestSolidMap = highestBlockMap;
+    Heightmap clearGroundMap = highestBlockMap;
+    std::unordered_map<uint16_t, VoxelMeta> metadata; // Keyed by index()
+    mutable std::array<SectionConnectivity, CHUNK_SECTIONS> sectionConnectivity{};
+    mutable uint32_t staleConnectivity = (1u << CHUNK_SECTIONS) - 1; // Bit per section
+};
+
+// Handle to a single voxel inside a loaded chunk. Returned by ChunkManager::getBlockAt
+// in place of a Voxel pointer, since voxels are no longer stored as structs.
+struct VoxelRef {
+    Chunk* chunk = nullptr;
+    glm::ivec3 local{0};
+
+    explicit operator bool() const { return chunk != nullptr; }
+
+    int type() const { return chunk->getType(local.x, local.y, local.z); }
+    void setType(int type) { chunk->setType(local.x, local.y, local.z, type); }
+
+    bool visible() const { return chunk->isVisible(local.x, local.y, local.z); }
+    void setVisible(bool visible) { chunk->setVisible(local.x, local.y, local.z, visible); }
+
+    void markUpdated() { chunk->setUpdated(local.x, local.y, local.z, true); }
+
+    VoxelMeta meta() const { return chunk->getMeta(local.x, local.y, local.z); }
+    void setMeta(const VoxelMeta& meta) { chunk->setMeta(local.x, local.y, local.z, meta); }
+
+    bool isSource() const { return meta().isSource; }
+    int sourceID() const { return meta().sourceID; }
+
+    void setSource(bool isSource) {
+        VoxelMeta m = meta();
+        m.isSource = isSource;
+        setMeta(m);
+    }
+
+    void setSourceID(int sourceID) {
+        VoxelMeta m = meta();
+        m.sourceID = sourceID;
+        setMeta(m);
+    }
 };
@@ -1,10 +1,15 @@
 #pragma once
 #include <unordered_map>
+#include <unordered_set>
 #include <utility>
 #include "terrainManager.hpp"
+#include "chunkPool.hpp"
+#include "frustum.hpp"
+#include "waterFrontier.hpp"
 #include <glm/gtx/string_cast.hpp>
 #include <functional>
 #include <thread>
+#include <chrono>
 #include <queue>
 #include <mutex>
 #include <condition_variable>
@@ -20,6 +25,28 @@ struct Vec3Hasher {
     }
 };
 
+// Level of detail for chunks beyond the simulated view distance. Each ring of
+// ringWidth chunks steps one level coarser, up to MAX_CHUNK_LOD.
+struct LodRings {
+    int distance = 12; // Outermost ring that is drawn, in chunks
+    int ringWidth = 3;
+
+    // Level for a chunk `ring` chunks away (Chebyshev) from the player's chunk
+    int levelAt(int ring, int viewDistance) const {
+        if (ring <= viewDistance) return 0;
+        return std::min(1 + (ring - viewDistance - 1) / ringWidth, MAX_CHUNK_LOD);
+    }
+};
+
+// Bit per section of each chunk the section walk from the camera reached
+using SectionMasks = std::unordered_map<ChunkKey, uint8_t, ChunkKeyHasher>;
+
+// A chunk outside the simulated area that is drawn from a downsampled mesh
+struct LodChunk {
+    Chunk* chunk;
+    int lod;
+};
+
 struct MinedBlock{
     glm::vec3 pos;
     glm::vec3 orientation;
@@ -47,7 +74,7 @@ public:
     }
 
     void updateTNT();
-    void handleWaterBlock(const glm::vec3& position, Voxel& block);
+    void handleWaterBlock(const glm::vec3& position, VoxelRef block);
     int getLowestFreeID() {
         int id;
         if (!freeIDs.empty()) {
@@ -84,11 +111,12 @@ public:
     }
 
     void onWaterSourceAdded(const glm::vec3& position, int sourceID) {
-        generateWaterQueue[position] = {sourceID, 0};
+        waterFrontier.push(glm::ivec3(glm::floor(position)), sourceID, 0);
         activeFlows[sourceID] = 1;
     }
 
-    void simulateWater(std::unordered_map<glm::vec3, std::pair<int, int>>& queue);
+    // Lets up to budget frontier cells flow one step
+    void simulateWater(size_t budget);
     void removeWater();
 
     void simulateSand(Chunk& chunk, int x, int y, int z);
@@ -97,13 +125,16 @@ public:
         currentTick++;
     }
     void generateWorld(int width, int depth, PerlinNoise& perlin);
-    void addChunk(ChunkKey key, Chunk chunk);
+    Chunk* createChunk(ChunkKey key); // Pool-backed, replaces any chunk already loaded at key
     void clear();
 
     void updateCombinedChunk(const glm::vec3& playerPosition, int radius);
-    void updateVoxelVisibility(Voxel& voxel, Chunk& chunk, const glm::ivec3& localPos);
-    void updateVoxelsAroundPlayer(const glm::vec3& playerPosition, int radius);
-    void updateWaterVoxels();
+    void updateVoxelVisibility(Chunk& chunk, const glm::ivec3& localPos);
+    void updateChunkVisibility(Chunk& chunk); // Word-parallel pass over the whole chunk
+    VisibilityMasks::Neighbours getNeighbours(const Chunk& chunk) const; // Missing chunks are nullptr
+    // Queues a voxel whose type changed; updateChangedVoxels recomputes it and its six neighbours
+    void voxelChanged(const Chunk& chunk, const glm::ivec3& localPos);
+    void updateChangedVoxels(); // Once per update, instead of rescanning around the player
 
     bool isPositionUnderwater(const glm::vec3& position) const;
 
@@ -118,7 +149,15 @@ public:
     void saveChunk(const Chunk& chunk, int chunkX, int chunkZ);
     void updateChunks(const glm::mat4& viewProjectionMatrix, const glm::vec3& playerPosition, int viewDistance);
     std::optional<glm::vec3> getPlacementPosition(const glm::vec3& targetBlockPos, const glm::vec3& playerPosition, const glm::vec3& viewDirection);
-    std::vector<Chunk*> getVisibleChunks(const glm::vec3& playerPosition, int viewDistance, const glm::mat4& viewProjectionMatrix);
+    // Loaded chunks within viewDistance whose non-empty sections intersect the view frustum
+    // and that a walk through connected sections from the camera reaches. visibleSections
+    // gets the reached sections of each chunk; it stays empty when the camera is outside
+    // any loaded section, and then every section is drawn.
+    std::vector<Chunk*> getVisibleChunks(const glm::vec3& cameraPosition, int viewDistance, const glm::mat4& viewProjectionMatrix,
+                                         SectionMasks& visibleSections);
+    // Saved chunks in the LOD rings that are in view; they are not simulated, so their data is static
+    std::vector<LodChunk> getLodChunks(const glm::vec3& playerPosition, int viewDistance, const LodRings& rings,
+                                       const glm::mat4& viewProjectionMatrix) const;
     // Replace a block at the given world position
     bool placeBlock(const glm::vec3& placementPosition, int newBlockType, const glm::vec3& playerPosition, const glm::vec3& playerSize);
 
@@ -144,30 +183,73 @@ public:
     const Chunk* getChunkAt(const glm::vec3& position) const; // Const version
     Chunk* getChunkAt(const glm::vec3& position);             // Non-const version
 
-    const Voxel* getBlockAt(const glm::vec3& position) const; // Const version
-    Voxel* getBlockAt(const glm::vec3& position);             // Non-const version
+    // Lookup by chunk coordinate: one ring grid probe, hashed map only on a miss
+    const Chunk* getChunk(int chunkX, int chunkZ) const {
+        const ChunkSlot& slot = chunkGrid[((chunkZ & gridMask) << gridShift) | (chunkX & gridMask)];
+        if (slot.chunk && slot.key.x == chunkX && slot.key.z == chunkZ) {
+            return slot.chunk;
+        }
+        auto it = chunks.find({chunkX, chunkZ});
+        return it != chunks.end() ? it->second : nullptr;
+    }
+    Chunk* getChunk(int chunkX, int chunkZ) {
+        return const_cast<Chunk*>(std::as_const(*this).getChunk(chunkX, chunkZ));
+    }
+
+    int getBlockTypeAt(const glm::vec3& position) const;      // -1 if the chunk is not loaded
+    VoxelRef getBlockAt(const glm::vec3& position);
 
-    const std::unordered_map<ChunkKey, Chunk, ChunkKeyHasher> getAllChunks() const;
-    std::vector<MinedBlock> getMinedBlocks() { return activeMinedBlocks; }
+    std::vector<const Chunk*> getAllChunks() const;
+    const std::vector<MinedBlock>& getMinedBlocks() const { return activeMinedBlocks; }
 
-    std::unordered_map<glm::ivec3, Voxel, Vec3Hasher> combinedChunk;
+    std::unordered_map<glm::ivec3, BlockID, Vec3Hasher> combinedChunk; // Block types around the player
     std::priority_queue<int, std::vector<int>, std::greater<int>> freeIDs; // Min-heap to track free IDs
     int nextID = 0; // Tracks the next available ID if freeIDs is empty
     int tempIDStart = INT_MAX;
     std::unordered_map<int, int> activeFlows; // Map sourceID to the count of active flows
-    std::unordered_map<glm::vec3, std::pair<int, int>> generateWaterQueue; 
+    WaterFrontier waterFrontier; // Cells whose water still has to flow
+    float waterTickSeconds = 0.5f;      // Wall-clock time between water steps
+    size_t waterCellsPerTick = 2048;    // Frontier cells a step processes at most
     std::vector<int> removeWaterQueue;
     std::unordered_map<int, std::vector<glm::vec3>> waterBlocksByID;
     std::vector<std::pair<int, int>> checkWater;
     std::unordered_map<int, triggeredTNT> activeTNT;
-    std::unordered_map<ChunkKey, Chunk, ChunkKeyHasher> chunks;
-    std::unordered_map<ChunkKey, Chunk, ChunkKeyHasher> savedChunks;
-    std::unordered_set<ChunkKey, ChunkKeyHasher> dirtyChunks; 
+    ChunkPool chunkPool; // Owns every chunk referenced by the two maps below
+    std::unordered_map<ChunkKey, Chunk*, ChunkKeyHasher> chunks;
+    std::unordered_map<ChunkKey, Chunk*, ChunkKeyHasher> savedChunks;
+    std::unordered_set<ChunkKey, ChunkKeyHasher> dirtyChunks; // Changed since the last mesh update
     int currentTick = 0;
 
 private:
+    // Toroidal grid of loaded chunks around the player, indexed by chunk coordinate
+    // mod its power-of-two size. Always at least as wide as the loaded square.
+    struct ChunkSlot {
+        ChunkKey key{0, 0};
+        Chunk* chunk = nullptr;
+    };
+
+    // Drops the items whose chunk is all air or outside the frustum, keeping their order
+    template <typename T, typename ChunkOf>
+    static void cullToFrustum(std::vector<T>& items, const Frustum& frustum, ChunkOf chunkOf);
+
+    // Breadth-first walk from the camera's section across section faces that are
+    // connected inside the section, only moving away from the camera and only into
+    // sections in the frustum. Collects the sections it enters; false if the camera
+    // is not inside a loaded section.
+    bool traverseSections(const glm::vec3& cameraPosition, const Frustum& frustum, SectionMasks& reached) const;
+
+    void resizeChunkGrid(int viewDistance);
+    void gridInsert(Chunk* chunk);
+    void gridErase(const ChunkKey& key);
+
+    int gridShift = 4;
+    int gridMask = (1 << 4) - 1;
+    std::vector<ChunkSlot> chunkGrid = std::vector<ChunkSlot>(1 << (2 * 4));
 
     bool updated;
     std::vector<MinedBlock> activeMinedBlocks;
+    std::unordered_set<glm::ivec3, Vec3Hasher> changedVoxels;      // World cells edited since the last update
+    std::unordered_set<ChunkKey, ChunkKeyHasher> staleVisibility; // Created or reloaded since the last update
+    std::chrono::steady_clock::time_point lastWaterTick = std::chrono::steady_clock::now();
 
 };
@@ -0,0 +1,75 @@
+#pragma once
+#include <unordered_map>
+#include <vector>
+#include "chunkManager.hpp"
+#include "chunkMeshWorkers.hpp"
+
+// Meshed faces of one chunk, grouped by block type. The batch turns them into
+// packed vertices or face records, both drawn with the shared quad indices.
+struct CachedChunkMesh {
+    const Chunk* chunk = nullptr;
+    VisibilityMasks::Neighbours neighbours; // As last submitted; border faces depend on them
+    int lod = 0;                             // Level the mesh was requested at
+    bool stale = true;
+    uint64_t ticket = 0;   // Latest meshing job; older results are dropped
+    uint32_t revision = 0; // Bumped whenever a new mesh arrives so GPU copies can tell they are outdated
+
+    ChunkMesh mesh; // Last finished mesh, kept on screen while a rebuild is in flight
+};
+
+// Per-chunk mesh cache keyed by chunk coordinate. Only chunks that were marked
+// dirty, whose neighbour on any side changed, or that are new get re-meshed;
+// every other chunk keeps its geometry from the previous batch.
+//
+// Re-meshing happens on the worker pool: update() snapshots the chunks that need
+// it and installs whatever meshes have finished since the previous call. Chunks in
+// the LOD rings are meshed at their level and again when their level changes.
+//
+// Only chunks in view are passed to update(). Meshes of chunks that leave the view
+// are kept until evictOutside() drops them, so turning around does not re-mesh.
+class ChunkMeshCache {
+public:
+    explicit ChunkMeshCache(const ChunkMesher& mesher, unsigned threadCount = ChunkMeshWorkers::defaultThreadCount())
+        : mesher(mesher), workers(mesher, threadCount) {}
+
+    // Marks a chunk and its four horizontal neighbours for a rebuild
+    void invalidate(const ChunkKey& key);
+    void clear() {
+        entries.clear();
+        countsStale = true;
+    }
+
+    // Submits stale entries of the given chunks and installs finished meshes.
+    // Returns how many meshes were installed.
+    size_t update(const ChunkManager& chunkManager, const std::vector<Chunk*>& chunks,
+                  const std::vector<LodChunk>& lodChunks = {});
+
+    // Forgets chunks more than radius chunks away from center in x or z
+    void evictOutside(const ChunkKey& center, int radius);
+
+    // True while meshes are still being built, so the caller keeps calling update()
+    bool hasPending() const { return workers.pending() > 0; }
+    size_t workerCount() const { return workers.threadCount(); }
+
+    const CachedChunkMesh* find(const ChunkKey& key) const {
+        auto it = entries.find(key);
+        return it != entries.end() ? &it->second : nullptr;
+    }
+
+    size_t faceCount() const { return totalFaces; }
+    size_t drawCount() const { return totalDraws; }
+    uint32_t maxDrawQuads() const { return largestDraw; } // Quads the shared index buffer has to cover
+
+private:
+    void request(CachedChunkMesh& entry, const Chunk* chunk, const VisibilityMasks::Neighbours& neighbours, int lod);
+
+    const ChunkMesher& mesher;
+    ChunkMeshWorkers workers;
+    std::unordered_map<ChunkKey, CachedChunkMesh, ChunkKeyHasher> entries;
+    MeshingMode builtMode = MeshingMode::Culled;
+    uint64_t nextTicket = 0; // Shared by all entries so a reloaded chunk never matches an old job
+    size_t totalFaces = 0;
+    size_t totalDraws = 0;
+    uint32_t largestDraw = 0;
+    bool countsStale = true; // Totals are only recounted after a mesh was installed or dropped
+};
@@ -0,0 +1,61 @@
+#pragma once
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include "chunkMesher.hpp"
+
+// Fixed pool of threads that mesh chunk snapshots. Jobs carry everything they
+// read, so workers never touch the ChunkManager; finished meshes wait in a result
+// list until the render thread collects them for upload.
+class ChunkMeshWorkers {
+public:
+    struct Job {
+        uint64_t ticket; // Lets the submitter tell which request a result answers
+        MeshingMode mode;
+        int lod;
+        ChunkSnapshot snapshot;
+    };
+
+    struct Result {
+        ChunkKey key;
+        uint64_t ticket;
+        ChunkMesh mesh;
+    };
+
+    // With zero threads every job is meshed inside submit()
+    explicit ChunkMeshWorkers(const ChunkMesher& mesher, unsigned threadCount = defaultThreadCount());
+    ~ChunkMeshWorkers();
+
+    ChunkMeshWorkers(const ChunkMeshWorkers&) = delete;
+    ChunkMeshWorkers& operator=(const ChunkMeshWorkers&) = delete;
+
+    void submit(Job job);
+
+    // Takes every mesh finished since the last call
+    std::vector<Result> collect();
+
+    // Jobs queued, being meshed or finished but not collected yet
+    size_t pending() const;
+    size_t threadCount() const { return threads.size(); }
+
+    // One core is left to the render thread
+    static unsigned defaultThreadCount() {
+        unsigned cores = std::thread::hardware_concurrency();
+        return cores > 1 ? cores - 1 : 0;
+    }
+
+private:
+    void run();
+
+    const ChunkMesher& mesher;
+    std::vector<std::thread> threads;
+
+    mutable std::mutex mutex;
+    std::condition_variable jobReady;
+    std::deque<Job> jobs;
+    std::vector<Result> results;
+    size_t busy = 0;
+    bool stopping = false;
+};
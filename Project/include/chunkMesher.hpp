@@ -0,0 +1,185 @@
+#pragma once
+#include <tga/tga.hpp>
+#include <tga/tga_utils.hpp>
+#include <array>
+#include <cstddef>
+#include <vector>
+#include "chunk.hpp"
+#include "visibilityMasks.hpp"
+
+// One exposed block face in chunk-local voxel coordinates. Greedy meshing merges
+// runs of equal faces, so a quad may span width x height voxels along the face's
+// in-plane axes, starting at (x, y, z).
+struct FaceQuad {
+    uint8_t x, y, z;
+    uint8_t face; // 0..5 in +x, -x, +y, -y, +z, -z order
+    BlockID type;
+    uint8_t width = 1;
+    uint8_t height = 1;
+    uint8_t ao = 0xFF; // Ambient occlusion 0..3 (3 = open) of face template vertex i in bits 2i..2i+1
+
+    int aoLevel(int vertex) const { return (ao >> (2 * vertex)) & 3; }
+
+    // Splits the quad along the 1-3 diagonal instead of 0-2 so that darkened
+    // corners do not bleed along the diagonal
+    bool flipsDiagonal() const { return aoLevel(0) + aoLevel(2) < aoLevel(1) + aoLevel(3); }
+};
+
+// Compact chunk vertex decoded by chunk.vert. Corner coordinates are integers in
+// chunk-local voxel units, offset by ChunkMesher::cornerOrigin().
+//   position:   x (5 bits) | y (6 bits) << 5 | z (5 bits) << 11 | face (3 bits) << 16 | ao (2 bits) << 19
+//   attributes: u (6 bits) | v (6 bits) << 6 | block type (8 bits) << 12
+struct PackedVertex {
+    uint32_t position;
+    uint32_t attributes;
+
+    static tga::VertexLayout layout() {
+        return {sizeof(PackedVertex), {{offsetof(PackedVertex, position), tga::Format::r32g32_uint}}};
+    }
+};
+
+// One whole quad for vertex pulling, expanded by chunk_faces.vert. Uses the
+// PackedVertex bit layout for the quad's origin voxel with (width, height) in
+// place of the uv. The position word carries all four corner AO levels
+// (FaceQuad::ao) at bit 19 and the diagonal flip at bit 27.
+struct FaceRecord {
+    uint32_t position;
+    uint32_t extent;
+};
+
+// Per-face data of the cube model for the chunk shaders (std430 layout).
+// Corner i of the face uses bits 5i..5i+4 of corners: x, y, z, u, v.
+struct PackedFaceTemplate {
+    glm::vec2 tileOrigin;
+    uint32_t corners;
+    uint32_t widthUVAxis;
+};
+
+// Faces of one chunk, grouped so every block type of a section is a contiguous
+// range. Groups are ordered by RenderLayer, so each layer's sub-mesh is a run of
+// groups. A face belongs to the section of its voxel and no quad crosses a section,
+// so the draws of sections the camera cannot see into can be left out.
+struct ChunkMesh {
+    struct Group {
+        BlockID type;
+        uint8_t section;
+        uint32_t firstFace;
+        uint32_t faceCount;
+        glm::ivec3 boundsMin{0}; // Box around the group's faces, in corner coordinates
+        glm::ivec3 boundsMax{0};
+    };
+
+    struct Layer {
+        uint32_t firstGroup = 0;
+        uint32_t groupCount = 0;
+    };
+
+    std::vector<FaceQuad> faces;
+    std::vector<Group> groups;
+    std::array<Layer, RENDER_LAYER_COUNT> layers; // Indexed by RenderLayer
+};
+
+// Immutable copy of everything meshing reads from a chunk, so the chunk can be
+// meshed on a worker thread while the world keeps changing. The four horizontal
+// neighbours only contribute the one-voxel border row that faces this chunk.
+struct ChunkSnapshot {
+    ChunkKey key{};
+    VoxelMask opaque{};
+    VoxelMask hiding{};                                // Opaque and not see-through
+    VoxelMask air{};
+    std::array<ChunkSection, CHUNK_SECTIONS> sections; // Block types
+    std::vector<uint8_t> waterFaces;                   // faceMask of every water voxel, in index order
+    std::array<VoxelMask, 4> borders{};                // Hiding border rows of the +x, -x, +z, -z neighbours
+    std::array<bool, 4> hasNeighbour{};
+
+    static ChunkSnapshot capture(const Chunk& chunk, const VisibilityMasks::Neighbours& neighbours);
+
+    BlockID getType(int x, int y, int z) const {
+        int i = Chunk::index(x, y, z);
+        return sections[i / SECTION_VOLUME].get(i % SECTION_VOLUME);
+    }
+
+    // Blocky copy at 1 / 2^lod resolution, see ChunkMesher::build
+    ChunkSnapshot downsampled(int lod) const;
+
+    // Whether the voxel hides faces, so leaves do not darken corners. Reaches one voxel
+    // into the horizontal neighbours. Diagonal neighbours, missing chunks and anything
+    // above or below the chunk read as not hiding.
+    bool isHiding(int x, int y, int z) const;
+
+    VisibilityMasks::NeighbourMasks neighbourMasks() const {
+        auto border = [&](int side) { return hasNeighbour[side] ? &borders[side] : nullptr; };
+        return {border(0), border(1), border(2), border(3)};
+    }
+};
+
+enum class MeshingMode {
+    Culled, // One quad per exposed face
+    Greedy  // Coplanar faces of the same block type merged into rectangles
+};
+
+// Builds chunk meshes that contain only faces next to air, water or leaves, including
+// across chunk borders, and turns faces into vertices using the cube model.
+//
+// Vertices use tiled UVs so merged quads can repeat their texture: uv counts
+// tiles (0..width, 0..height) and the atlas origin of the face's tile is looked up
+// per face. fs.frag wraps uv into the tile with TILE_SIZE.
+//
+// Every quad's four vertices are emitted in QUAD_INDICES order, so all chunk draws
+// share one static index buffer. Quads whose AO calls for the other diagonal start
+// one vertex later, which keeps the winding.
+//
+// Ambient occlusion is baked per corner from the three voxels next to it in front
+// of the face, so it only costs anything when a chunk is re-meshed. Greedy meshing
+// only merges faces with the same AO.
+class ChunkMesher {
+public:
+    static constexpr uint32_t VERTICES_PER_FACE = 4;
+    static constexpr uint32_t INDICES_PER_FACE = 6;
+    static constexpr std::array<uint32_t, INDICES_PER_FACE> QUAD_INDICES = {0, 1, 2, 2, 3, 0};
+
+    // Size of one face tile in the cube-net texture, must match fs.frag
+    static constexpr float TILE_SIZE_U = 0.332826f;
+    static constexpr float TILE_SIZE_V = 0.249619f;
+
+    explicit ChunkMesher(const tga::Obj& cubeModel);
+
+    MeshingMode mode = MeshingMode::Culled; // Selected mode; build() takes it explicitly
+
+    // Safe to call from several threads at once, it only reads the mesher.
+    // lod > 0 meshes a copy downsampled by 2^lod per axis: a cell is solid when at
+    // least half of it is, and takes the type of its topmost solid voxel so the
+    // surface keeps its colour. Such meshes are always greedy and treat the
+    // neighbours as air, so every border gets a skirt that hides the cracks
+    // between chunks of different levels.
+    ChunkMesh build(const ChunkSnapshot& snapshot, MeshingMode meshingMode, int lod = 0) const;
+
+    // Writes the 4 packed vertices of one quad
+    void emitFace(const FaceQuad& quad, PackedVertex* vertices) const;
+    static FaceRecord packFace(const FaceQuad& quad);
+
+    // Model-space position of packed corner (0, 0, 0); add it to the chunk position
+    glm::vec3 cornerOrigin() const { return cubeMin; }
+
+    // Corners, uvs and atlas tile of each face, indexed by face (uploaded for the chunk shaders)
+    std::array<PackedFaceTemplate, 6> packedFaceTemplates() const;
+
+    // Converts a cube model (e.g. the dropped-block model) to the tiled UV layout
+    void toTiledUVs(tga::Obj& model) const;
+
+private:
+    struct FaceTemplate {
+        std::array<tga::Vertex, VERTICES_PER_FACE> vertices; // QUAD_INDICES order, uv in {0, 1}
+        std::array<glm::ivec3, VERTICES_PER_FACE> corners;   // Unit cube corner of each vertex
+        glm::vec2 tileOrigin;
+        int widthUVAxis; // uv component that runs along the quad's width
+    };
+
+    static void reorderToQuadIndices(FaceTemplate& faceTemplate, const std::array<uint32_t, INDICES_PER_FACE>& indices);
+    std::vector<FaceQuad> cullFaces(const ChunkSnapshot& snapshot) const;
+    uint8_t faceAO(const ChunkSnapshot& snapshot, int x, int y, int z, int face) const;
+    std::vector<FaceQuad> mergeFaces(const std::vector<FaceQuad>& faces) const;
+
+    std::array<FaceTemplate, 6> templates;
+    glm::vec3 cubeMin{0.0f};
+};
@@ -0,0 +1,47 @@
+#pragma once
+#include <memory>
+#include <vector>
+#include "chunk.hpp"
+
+// Fixed-size slab allocator for chunks. Chunks never move once acquired, so the
+// chunk maps only shuffle pointers and other code can hold on to chunk addresses.
+class ChunkPool {
+public:
+    static constexpr size_t CHUNKS_PER_SLAB = 64;
+
+    ChunkPool() = default;
+    ChunkPool(const ChunkPool&) = delete;
+    ChunkPool& operator=(const ChunkPool&) = delete;
+
+    // Returns a chunk in its default (all air, not generated) state
+    Chunk* acquire() {
+        if (freeList.empty()) {
+            growSlab();
+        }
+        Chunk* chunk = freeList.back();
+        freeList.pop_back();
+        return chunk;
+    }
+
+    void release(Chunk* chunk) {
+        if (!chunk) return;
+        *chunk = Chunk(); // Reset so the next acquire hands out a clean chunk
+        freeList.push_back(chunk);
+    }
+
+    size_t capacity() const { return slabs.size() * CHUNKS_PER_SLAB; }
+    size_t inUse() const { return capacity() - freeList.size(); }
+
+private:
+    void growSlab() {
+        slabs.push_back(std::make_unique<Chunk[]>(CHUNKS_PER_SLAB));
+        Chunk* slab = slabs.back().get();
+        // Push in reverse so chunks are handed out in address order
+        for (size_t i = CHUNKS_PER_SLAB; i-- > 0;) {
+            freeList.push_back(&slab[i]);
+        }
+    }
+
+    std::vector<std::unique_ptr<Chunk[]>> slabs;
+    std::vector<Chunk*> freeList;
+};
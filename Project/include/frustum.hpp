@@ -0,0 +1,70 @@
+#pragma once
+#include <array>
+#include <cstdint>
+#include <vector>
+#include <glm/glm.hpp>
+
+// Axis-aligned boxes stored as one array per coordinate, so a frustum test over
+// all of them is a branch-free loop the compiler can vectorize
+struct BoxBatch {
+    std::vector<float> minX, minY, minZ;
+    std::vector<float> maxX, maxY, maxZ;
+
+    void clear() {
+        for (auto* values : {&minX, &minY, &minZ, &maxX, &maxY, &maxZ}) values->clear();
+    }
+
+    void push(const glm::vec3& min, const glm::vec3& max) {
+        minX.push_back(min.x);
+        minY.push_back(min.y);
+        minZ.push_back(min.z);
+        maxX.push_back(max.x);
+        maxY.push_back(max.y);
+        maxZ.push_back(max.z);
+    }
+
+    size_t size() const { return minX.size(); }
+};
+
+// View frustum as six planes taken from the rows of a view-projection matrix
+// (Gribb/Hartmann). A point p is inside a plane when dot(plane.xyz, p) + plane.w >= 0.
+struct Frustum {
+    std::array<glm::vec4, 6> planes;
+
+    static Frustum fromMatrix(const glm::mat4& viewProjection) {
+        auto row = [&](int i) {
+            return glm::vec4(viewProjection[0][i], viewProjection[1][i], viewProjection[2][i], viewProjection[3][i]);
+        };
+        // The near plane assumes a -1..1 depth range; with 0..1 it lies slightly
+        // behind the real one, which only keeps a few extra boxes
+        return {{row(3) + row(0), row(3) - row(0),
+                 row(3) + row(1), row(3) - row(1),
+                 row(3) + row(2), row(3) - row(2)}};
+    }
+
+    // A box is outside when its corner furthest along a plane's normal is behind that plane
+    bool intersects(const glm::vec3& min, const glm::vec3& max) const {
+        for (const glm::vec4& plane : planes) {
+            glm::vec3 corner(plane.x >= 0 ? max.x : min.x, plane.y >= 0 ? max.y : min.y, plane.z >= 0 ? max.z : min.z);
+            if (glm::dot(glm::vec3(plane), corner) + plane.w < 0) return false;
+        }
+        return true;
+    }
+
+    // Same test for every box in the batch; visible[i] is 1 when box i intersects
+    void cull(const BoxBatch& boxes, std::vector<uint8_t>& visible) const {
+        const size_t count = boxes.size();
+        visible.assign(count, 1);
+        uint8_t* out = visible.data();
+        for (glm::vec4 plane : planes) { // By value, so stores to visible cannot alias it
+            // The furthest corner picks the same side of every box, so choose arrays per plane
+            const float* xs = plane.x >= 0 ? boxes.maxX.data() : boxes.minX.data();
+            const float* ys = plane.y >= 0 ? boxes.maxY.data() : boxes.minY.data();
+            const float* zs = plane.z >= 0 ? boxes.maxZ.data() : boxes.minZ.data();
+            for (size_t i = 0; i < count; ++i) {
+                float distance = plane.x * xs[i] + plane.y * ys[i] + plane.z * zs[i] + plane.w;
+                out[i] &= distance >= 0.0f ? 1 : 0;
+            }
+        }
+    }
+};
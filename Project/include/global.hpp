@@ -8,15 +8,25 @@
 #include <vulkan/vulkan.h>
 #include <tga/tga_vulkan/tga_vulkan_WSI.hpp>
 #include "player.hpp"
+#include "chunkMeshCache.hpp"
+#include "rangeAllocator.hpp"
 #include <glm/gtx/string_cast.hpp>
 #include <span>
 #include <sstream> 
 #include <ApplicationServices/ApplicationServices.h>
 #include <vector>
+#include <limits>
 
-void handleOptions(tga::Window& window, tga::Interface& tgai, int& cullTimer, bool& enableCull, int& viewDistance, int& distanceTimer, auto& camData){
+enum class ChunkRenderMode {
+    PackedVertices, // Four PackedVertex per face in a vertex buffer, chunk.vert
+    FacePulling     // One FaceRecord per face in a storage buffer, chunk_faces.vert
+};
+
+void handleOptions(tga::Window& window, tga::Interface& tgai, int& cullTimer, bool& enableCull, int& viewDistance, LodRings& lodRings, int& distanceTimer, auto& camData,
+                   ChunkMesher& chunkMesher, ChunkManager& chunkManager, ChunkRenderMode& chunkRenderMode){
     if (tgai.keyDown(window, tga::Key::P) && cullTimer <= 0) {
         enableCull = !enableCull;
+        chunkManager.setUpdated(); // Rewriting the draw list restores the instance counts the cull passes zeroed
         if(enableCull){
             std::cout << "Cull is on.\n";
         } else {
@@ -24,6 +34,20 @@ void handleOptions(tga::Window& window, tga::Interface& tgai, int& cullTimer, bo
         }
         cullTimer = 50;
     }
+    if (tgai.keyDown(window, tga::Key::G) && cullTimer <= 0) {
+        bool greedy = chunkMesher.mode != MeshingMode::Greedy;
+        chunkMesher.mode = greedy ? MeshingMode::Greedy : MeshingMode::Culled;
+        std::cout << (greedy ? "Greedy meshing is on.\n" : "Greedy meshing is off.\n");
+        chunkManager.setUpdated(); // Rebuild the batch with the new mesher
+        cullTimer = 50;
+    }
+    if (tgai.keyDown(window, tga::Key::V) && cullTimer <= 0) {
+        bool pulling = chunkRenderMode != ChunkRenderMode::FacePulling;
+        chunkRenderMode = pulling ? ChunkRenderMode::FacePulling : ChunkRenderMode::PackedVertices;
+        std::cout << (pulling ? "Face pulling is on.\n" : "Face pulling is off.\n");
+        chunkManager.setUpdated(); // Rebuild the batch in the new format
+        cullTimer = 50;
+    }
     if(cullTimer > 0){
         cullTimer--;
     }
@@ -37,6 +61,19 @@ void handleOptions(tga::Window& window, tga::Interface& tgai, int& cullTimer, bo
             std::cout << "Current view distance is: " << viewDistance << " chunks.\n";
             distanceTimer = 40;
     }
+    // Full detail stays capped by simulation cost, the LOD rings reach much further
+    if (tgai.keyDown(window, tga::Key::Right) && lodRings.distance < 48 && distanceTimer <= 0) {
+        lodRings.distance += lodRings.ringWidth;
+        std::cout << "Current LOD distance is: " << lodRings.distance << " chunks.\n";
+        chunkManager.setUpdated();
+        distanceTimer = 40;
+    }
+    if (tgai.keyDown(window, tga::Key::Left) && lodRings.distance > viewDistance && distanceTimer <= 0) {
+        lodRings.distance = std::max(lodRings.distance - lodRings.ringWidth, viewDistance);
+        std::cout << "Current LOD distance is: " << lodRings.distance << " chunks.\n";
+        chunkManager.setUpdated();
+        distanceTimer = 40;
+    }
     if(distanceTimer > 0){
             distanceTimer--;
     }
@@ -332,12 +369,13 @@ void saveWorldToBinary(const ChunkManager& chunkManager, const glm::vec3& player
         outFile.write(reinterpret_cast<const char*>(&count), sizeof(count));
     }
 
-    // Save generateWaterQueue
-    uint32_t generateWaterQueueCount = chunkManager.generateWaterQueue.size();
-    outFile.write(reinterpret_cast<const char*>(&generateWaterQueueCount), sizeof(generateWaterQueueCount));
-    for (const auto& [pos, data] : chunkManager.generateWaterQueue) {
-        const int sourceID = data.first;
-        const int travelDistance = data.second;
+    // Save the water frontier, oldest cell first
+    uint32_t waterFrontierCount = chunkManager.waterFrontier.size();
+    outFile.write(reinterpret_cast<const char*>(&waterFrontierCount), sizeof(waterFrontierCount));
+    for (const WaterFrontier::Cell& cell : chunkManager.waterFrontier.pending()) {
+        const glm::vec3 pos(WaterFrontier::unpack(cell.key));
+        const int sourceID = cell.sourceID;
+        const int travelDistance = cell.travelDistance;
         outFile.write(reinterpret_cast<const char*>(&pos), sizeof(pos));          // Save position
         outFile.write(reinterpret_cast<const char*>(&sourceID), sizeof(sourceID)); // Save sourceID
         outFile.write(reinterpret_cast<const char*>(&travelDistance), sizeof(travelDistance)); // Save travelDistance
@@ -368,16 +406,22 @@ void saveWorldToBinary(const ChunkManager& chunkManager, const glm::vec3& player
 
 
     // Save chunks
-    for (const auto& [key, chunk] : chunkManager.getAllChunks()) {
-        outFile.write(reinterpret_cast<const char*>(&key), sizeof(key));
+    for (const Chunk* chunkPtr : chunkManager.getAllChunks()) {
+        const Chunk& chunk = *chunkPtr;
+        outFile.write(reinterpret_cast<const char*>(&chunk.key), sizeof(chunk.key));
         outFile.write(reinterpret_cast<const char*>(&chunk.position), sizeof(chunk.position));
         // Write the number of non-zero voxels in the chunk
         int voxelCount = 0;
-        for (int x = 0; x < CHUNK_SIZE; ++x) {
-            for (int y = 0; y < CHUNK_SIZE_Y; ++y) {
-                for (int z = 0; z < CHUNK_SIZE; ++z) {
-                    const Voxel& voxel = chunk.voxels[x][y][z];
-                    if (voxel.type != 0) {
+        for (int y = 0; y < CHUNK_SIZE_Y; ++y) {
+            const ChunkSection& section = chunk.section(y / SECTION_HEIGHT);
+            if (section.isUniform()) { // Whole layers of one type, counted without reading voxels
+                voxelCount += section.uniformType() != 0 ? SECTION_VOLUME : 0;
+                y += SECTION_HEIGHT - 1;
+                continue;
+            }
+            for (int z = 0; z < CHUNK_SIZE; ++z) {
+                for (int x = 0; x < CHUNK_SIZE; ++x) {
+                    if (chunk.getType(x, y, z) != 0) {
                         voxelCount++;
                     }
                 }
@@ -386,21 +430,25 @@ void saveWorldToBinary(const ChunkManager& chunkManager, const glm::vec3& player
         outFile.write(reinterpret_cast<const char*>(&voxelCount), sizeof(voxelCount));
 
         int legitBlocks = 0;
-        for (int x = 0; x < CHUNK_SIZE; ++x) {
-            for (int y = 0; y < CHUNK_SIZE_Y; ++y) {
-                for (int z = 0; z < CHUNK_SIZE; ++z) {
-                    const Voxel& voxel = chunk.voxels[x][y][z];
-                    if (voxel.type != 0) {
-                        if (x < 0 || x >= CHUNK_SIZE || y < 0 || y >= CHUNK_SIZE_Y || z < 0 || z >= CHUNK_SIZE) {
-                            continue;
-                        }
+        for (int y = 0; y < CHUNK_SIZE_Y; ++y) {
+            if (chunk.section(y / SECTION_HEIGHT).isEmpty()) { // Air sections write nothing
+                y += SECTION_HEIGHT - 1;
+                continue;
+            }
+            for (int z = 0; z < CHUNK_SIZE; ++z) {
+                for (int x = 0; x < CHUNK_SIZE; ++x) {
+                    // Keep the on-disk voxel record layout (int type, bool isSource, int sourceID, bool visible)
+                    int type = chunk.getType(x, y, z);
+                    if (type != 0) {
+                        VoxelMeta meta = chunk.getMeta(x, y, z);
+                        bool visible = chunk.isVisible(x, y, z);
                         outFile.write(reinterpret_cast<const char*>(&x), sizeof(x));
                         outFile.write(reinterpret_cast<const char*>(&y), sizeof(y));
                         outFile.write(reinterpret_cast<const char*>(&z), sizeof(z));
-                        outFile.write(reinterpret_cast<const char*>(&voxel.type), sizeof(voxel.type));
-                        outFile.write(reinterpret_cast<const char*>(&voxel.isSource), sizeof(voxel.isSource));
-                        outFile.write(reinterpret_cast<const char*>(&voxel.sourceID), sizeof(voxel.sourceID));
-                        outFile.write(reinterpret_cast<const char*>(&voxel.visible), sizeof(voxel.visible));
+                        outFile.write(reinterpret_cast<const char*>(&type), sizeof(type));
+                        outFile.write(reinterpret_cast<const char*>(&meta.isSource), sizeof(meta.isSource));
+                        outFile.write(reinterpret_cast<const char*>(&meta.sourceID), sizeof(meta.sourceID));
+                        outFile.write(reinterpret_cast<const char*>(&visible), sizeof(visible));
                         legitBlocks++;
                     }
                 }
@@ -468,17 +516,17 @@ bool loadWorldFromBinary(ChunkManager& chunkManager, const std::string& fileName
         chunkManager.activeFlows[sourceID] = count;
     }
 
-    // Load generateWaterQueue
-    uint32_t generateWaterQueueCount;
-    inFile.read(reinterpret_cast<char*>(&generateWaterQueueCount), sizeof(generateWaterQueueCount));
-    for (uint32_t i = 0; i < generateWaterQueueCount; ++i) {
+    // Load the water frontier
+    uint32_t waterFrontierCount;
+    inFile.read(reinterpret_cast<char*>(&waterFrontierCount), sizeof(waterFrontierCount));
+    for (uint32_t i = 0; i < waterFrontierCount; ++i) {
         glm::vec3 pos;
         int sourceID;
         int travelDistance;
         inFile.read(reinterpret_cast<char*>(&pos), sizeof(pos));                // Load position
         inFile.read(reinterpret_cast<char*>(&sourceID), sizeof(sourceID));      // Load sourceID
         inFile.read(reinterpret_cast<char*>(&travelDistance), sizeof(travelDistance)); // Load travelDistance
-        chunkManager.generateWaterQueue[pos] = {sourceID, travelDistance};       // Add to queue
+        chunkManager.waterFrontier.push(glm::ivec3(glm::floor(pos)), sourceID, travelDistance); // Add to queue
     }
 
     // Load removeWaterQueue
@@ -519,24 +567,14 @@ bool loadWorldFromBinary(ChunkManager& chunkManager, const std::string& fileName
         inFile.read(reinterpret_cast<char*>(&position), sizeof(position));
         inFile.read(reinterpret_cast<char*>(&voxelCount), sizeof(voxelCount));
 
-        // Create the chunk
-        Chunk chunk;
-        chunk.key = key;
+        // Create the chunk in pooled storage
+        Chunk& chunk = *chunkManager.createChunk(key);
         chunk.position = position;
         chunk.isGenerated = true;
         chunk.isDirty = true;
 
         
-        // Initialize all voxels to type 0 and visible false
-        for (int x = 0; x < CHUNK_SIZE; ++x) {
-            for (int y = 0; y < CHUNK_SIZE_Y; ++y) {
-                for (int z = 0; z < CHUNK_SIZE; ++z) {
-                    chunk.voxels[x][y][z].type = 0;
-                    chunk.voxels[x][y][z].visible = false;
-                }
-            }
-        }
-
+        // A new chunk starts with every voxel as invisible air
         // Read and overwrite non-zero voxels
         for (uint32_t j = 0; j < voxelCount; ++j) {
             int x, y, z;
@@ -555,16 +593,17 @@ bool loadWorldFromBinary(ChunkManager& chunkManager, const std::string& fileName
             inFile.read(reinterpret_cast<char*>(&visible), sizeof(visible));
 
             // Validate coordinates
-            if (x >= 0 && x < CHUNK_SIZE && y >= 0 && y < CHUNK_SIZE_Y && z >= 0 && z < CHUNK_SIZE) {
-                chunk.voxels[x][y][z].type = type;
-                chunk.voxels[x][y][z].visible = visible;
-                chunk.voxels[x][y][z].isSource = isSource;
-                chunk.voxels[x][y][z].sourceID = sourceID;
+            if (Chunk::inBounds(x, y, z)) {
+                chunk.setType(x, y, z, type);
+                chunk.setVisible(x, y, z, visible);
+                VoxelMeta meta = chunk.getMeta(x, y, z);
+                meta.isSource = isSource;
+                meta.sourceID = sourceID;
+                chunk.setMeta(x, y, z, meta);
             }
         }
 
-        // Add the chunk to the manager
-        chunkManager.addChunk(key, std::move(chunk));
+        chunk.optimizeSections();
         std::cout << "Chunk " << i + 1 << "/" << chunkCount << " loaded with " << voxelCount << " blocks.\n";
     }
 
@@ -616,30 +655,73 @@ struct Batch {
     Element blockTypes;
     Element boundingBoxes;
     Element materialIDs;
+    Element faces; // FaceRecords of a face-pulling chunk batch
+    Element visibility; // Per draw: passed the last occlusion test, written by the cull passes
+    Element compactedDraws; // Commands of the opaque draws that passed the last occlusion test, back to back
+    Element lateDraws; // Commands phase two let through: opaque ones from 0, alpha-tested ones from the opaque count
     std::vector<tga::Texture> textures;
 
     void destroy(tga::Interface& tgai) {
         vertex.destroy(tgai);
+        faces.destroy(tgai);
         index.destroy(tgai);
         modelMatrices.destroy(tgai);
         drawCommands.destroy(tgai);
         blockTypes.destroy(tgai);
         boundingBoxes.destroy(tgai);
         materialIDs.destroy(tgai);
+        visibility.destroy(tgai);
+        compactedDraws.destroy(tgai);
+        lateDraws.destroy(tgai);
+    }
+};
+
+// Index pattern shared by every packed chunk draw: quad i uses vertices 4i..4i+3
+// in ChunkMesher::QUAD_INDICES order. Grows to the largest draw and never shrinks.
+struct QuadIndexBuffer {
+    tga::Buffer buffer;
+    uint32_t quadCapacity{0};
+
+    void reserve(tga::Interface& tgai, uint32_t quadCount) {
+        if (buffer && quadCount <= quadCapacity) return;
+        destroy(tgai);
+
+        quadCapacity = std::max<uint32_t>(quadCount, 1024);
+        std::vector<uint32_t> indices(size_t(quadCapacity) * ChunkMesher::INDICES_PER_FACE);
+        for (uint32_t quad = 0; quad < quadCapacity; ++quad) {
+            for (uint32_t i = 0; i < ChunkMesher::INDICES_PER_FACE; ++i) {
+                indices[quad * ChunkMesher::INDICES_PER_FACE + i] = quad * ChunkMesher::VERTICES_PER_FACE + ChunkMesher::QUAD_INDICES[i];
+            }
+        }
+        size_t size = indices.size() * sizeof(uint32_t);
+        auto staging = tgai.createStagingBuffer({size, tga::memoryAccess(indices)});
+        buffer = tgai.createBuffer({tga::BufferUsage::index, size, staging});
+        tgai.free(staging);
+    }
+
+    void destroy(tga::Interface& tgai) {
+        if (buffer) tgai.free(buffer);
+        buffer = {};
     }
 };
 
 struct BatchRenderData {
-    tga::RenderPass geometryPass;
-    tga::InputSet geometryInput;
-    tga::Buffer elementCount;
-    tga::InputSet cullInput;
+    // One pass per RenderLayer, since blending and alpha testing are pipeline state.
+    // Batches without layers only fill the opaque entry.
+    std::array<tga::RenderPass, RENDER_LAYER_COUNT> geometryPasses;
+    std::array<tga::InputSet, RENDER_LAYER_COUNT> geometryInputs;
+    tga::Buffer elementCount; // CullBounds
+    tga::InputSet cullInput;      // Phase one, chunk batches only
+    tga::InputSet occlusionInput; // Phase two, chunk batches only
 
     void destroy(tga::Interface& tgai) {
-        if (geometryPass) tgai.free(geometryPass);
-        if (geometryInput) tgai.free(geometryInput);
+        for (int layer = 0; layer < RENDER_LAYER_COUNT; ++layer) {
+            if (geometryPasses[layer]) tgai.free(geometryPasses[layer]);
+            if (geometryInputs[layer]) tgai.free(geometryInputs[layer]);
+        }
         if (elementCount) tgai.free(elementCount);
         if (cullInput) tgai.free(cullInput);
+        if (occlusionInput) tgai.free(occlusionInput);
     }
 };
 
@@ -648,234 +730,531 @@ struct AABB {
     glm::vec4 max; //using vec4 for alignment reasons
 };
 
+// Draw counts read by the cull passes. Opaque draws come first in a chunk batch,
+// followed by the alpha-tested ones; only the opaque ones are drawn before the depth
+// pyramid is built. A non-zero compactedCount makes phase one work on
+// Batch::compactedDraws instead of the whole opaque slice. lateOpaqueSlots is the
+// upper bound the late opaque list is submitted with, phase one clears that many.
+struct CullBounds {
+    uint32_t drawCount;
+    uint32_t opaqueCount;
+    uint32_t alphaTestedCount;
+    uint32_t compactedCount;
+    uint32_t lateOpaqueSlots;
+};
 
-Batch generateVoxelBatch(tga::Obj cubeModel, const std::vector<Chunk*>& visibleChunks, tga::Interface& tgai, const glm::vec3& playerPosition, int viewDistance) {
-    Batch batch;
+// Feedback of the occlusion pass, one counter per outcome. compacted, lateOpaque
+// and lateAlphaTested are also the slot counters of Batch::compactedDraws and the
+// two lists in Batch::lateDraws.
+struct CullStats {
+    uint32_t drawn;
+    uint32_t frustumCulled;
+    uint32_t occlusionCulled;
+    uint32_t compacted;
+    uint32_t lateOpaque;
+    uint32_t lateAlphaTested;
+};
 
-    batch.textures = allTextures;
 
-    size_t maxVoxels = visibleChunks.size() * CHUNK_SIZE * CHUNK_SIZE_Y * CHUNK_SIZE;
+// Reusable upload memory for the chunk store. All uploads of a frame are recorded
+// into the frame's command buffer, and TGA waits for that buffer's previous
+// submission before recording it again, so the arena restarts at 0 every frame
+// instead of cycling like a multi-frame ring. It only ever grows.
+struct StagingArena {
+    static constexpr size_t ALIGNMENT = 16;
+
+    tga::StagingBuffer staging;
+    uint8_t* mapping{nullptr};
+    size_t capacity{0};
+    size_t head{0};
+
+    static size_t aligned(size_t size) { return (size + ALIGNMENT - 1) & ~(ALIGNMENT - 1); }
+
+    // Starts a frame that pushes at most size bytes (sum of aligned() sizes)
+    void begin(tga::Interface& tgai, size_t size) {
+        head = 0;
+        if (staging && size <= capacity) return;
+        if (staging) tgai.free(staging);
+        capacity = std::max({size, capacity * 2, size_t(1) << 20});
+        staging = tgai.createStagingBuffer({capacity});
+        mapping = static_cast<uint8_t*>(tgai.getMapping(staging));
+        if (!mapping) {
+            throw std::runtime_error("Failed to map staging buffer");
+        }
+    }
 
-    // Initialize staging buffers
-    auto initStaging = [&](Batch::Element& element, size_t elementSize, size_t maxSize) {
-        element.capacity = maxSize;
-        element.staging = tgai.createStagingBuffer({maxSize * elementSize});
-    };
+    // Records an upload of size bytes to dst at dstOffset and returns where to write them
+    template <typename T>
+    T* push(tga::CommandRecorder& rec, tga::Buffer dst, size_t dstOffset, size_t size) {
+        if (size == 0) return nullptr;
+        if (head + size > capacity) {
+            throw std::runtime_error("Staging arena overflow");
+        }
+        rec.bufferUpload(staging, dst, size, head, dstOffset);
+        T* data = reinterpret_cast<T*>(mapping + head);
+        head += aligned(size);
+        return data;
+    }
 
-    initStaging(batch.vertex, sizeof(tga::Vertex), maxVoxels * cubeModel.vertexBuffer.size()); 
-    initStaging(batch.index, sizeof(uint32_t), maxVoxels * cubeModel.indexBuffer.size());   
-    initStaging(batch.modelMatrices, sizeof(glm::mat4), maxVoxels);                         
-    initStaging(batch.drawCommands, sizeof(tga::DrawIndexedIndirectCommand), maxVoxels);     
-    initStaging(batch.materialIDs, sizeof(uint32_t), maxVoxels);                           
-    initStaging(batch.boundingBoxes, sizeof(AABB), maxVoxels);   
-    
-    auto appendData = [&]<typename T>(Batch::Element& elem, std::span<T> span) {
-                        if (elem.count + span.size() > elem.capacity) {
-                            throw std::runtime_error("Buffer overflow in appendData");
-                        }
+    void destroy(tga::Interface& tgai) {
+        if (staging) tgai.free(staging);
+        staging = {};
+        mapping = nullptr;
+        capacity = 0;
+    }
+};
 
-                        void* mappedMemory = tgai.getMapping(elem.staging);
-                        if (!mappedMemory) {
-                            throw std::runtime_error("Failed to map staging buffer");
-                        }
+// Grows a buffer that is rewritten in place by doubling; returns true when it was recreated
+inline bool reserveElement(tga::Interface& tgai, Batch::Element& element, tga::BufferUsage usage, size_t elementSize, size_t count) {
+    if (element.buffer && count <= element.capacity) return false;
+    element.destroy(tgai);
+    element.capacity = std::max({count, element.capacity * 2, size_t(256)});
+    element.buffer = tgai.createBuffer({usage, element.capacity * elementSize});
+    return true;
+}
 
-                        auto writePos = static_cast<T*>(mappedMemory) + elem.count;
-                        std::memcpy(writePos, span.data(), span.size_bytes());
-                        elem.count += span.size();
-                    };                              // Add one for the sun
+// Long-lived GPU copy of the chunk meshes. The faces of every cached chunk occupy a
+// range of one geometry buffer, either packed vertices (batch.vertex) or face records
+// (batch.faces), placed by a RangeAllocator and only rewritten when the chunk is
+// re-meshed while in view. Chunk batches have no index element; they are drawn with a QuadIndexBuffer.
+// The per-draw arrays are rewritten on every update but keep their buffers until
+// they have to grow.
+class ChunkGpuStore {
+public:
+    static constexpr uint32_t MIN_HEAP_FACES = 1 << 18;
+
+    struct DrawRange {
+        uint32_t first = 0;
+        uint32_t count = 0;
+    };
 
-    // Process visible chunks
-    for (auto* chunk : visibleChunks) {
-        for (int x = 0; x < CHUNK_SIZE; ++x) {
-            for (int y = 0; y < CHUNK_SIZE_Y; ++y) {
-                for (int z = 0; z < CHUNK_SIZE; ++z) {
-                    const Voxel& voxel = chunk->voxels[x][y][z];
-                    if (!voxel.visible) continue;
+    Batch batch; // Buffers stay valid until update() reports that one was recreated
+    std::array<DrawRange, RENDER_LAYER_COUNT> layerDraws; // Slice of the draw list per RenderLayer
+
+    // Uploads re-meshed chunks and the draw list. Returns true when a buffer handle
+    // changed, so input sets that reference the batch have to be recreated.
+    // Translucent draws are ordered back to front as seen from cameraPosition.
+    // Only groups of the sections in visibleSections are drawn; chunks it does not
+    // list draw all of theirs.
+    bool update(tga::Interface& tgai, tga::CommandRecorder& rec, const ChunkMesher& mesher, const ChunkMeshCache& meshCache,
+                const std::vector<Chunk*>& visibleChunks, const SectionMasks& visibleSections, ChunkRenderMode renderMode,
+                const glm::vec3& cameraPosition) {
+        bool recreated = false;
+        const bool facePulling = renderMode == ChunkRenderMode::FacePulling;
+        batch.textures = allTextures;
+
+        // A different geometry format starts the heap from scratch
+        if (renderMode != builtMode || !geometry().buffer) {
+            batch.vertex.destroy(tgai);
+            batch.faces.destroy(tgai);
+            batch.vertex = {};
+            batch.faces = {};
+            builtMode = renderMode;
+            resident.clear();
+            allocator.reset(0);
+        }
 
-                    glm::vec3 worldPosition = chunk->position + glm::vec3(x, y, z);
+        // Release chunks the mesh cache forgot; chunks that are only out of view keep their range
+        for (auto it = resident.begin(); it != resident.end();) {
+            if (!meshCache.find(it->first)) {
+                allocator.free(it->second.offset, it->second.faceCount);
+                it = resident.erase(it);
+            } else {
+                ++it;
+            }
+        }
 
-                    
+        // Chunks without an up to date copy get a new range
+        std::vector<const CachedChunkMesh*> uploads;
+        for (const Chunk* chunk : visibleChunks) {
+            const CachedChunkMesh* cached = meshCache.find(chunk->key);
+            if (!cached) continue;
+            auto it = resident.find(chunk->key);
+            if (it != resident.end()) {
+                if (it->second.revision == cached->revision) continue;
+                allocator.free(it->second.offset, it->second.faceCount);
+                resident.erase(it);
+            }
+            uploads.push_back(cached);
+        }
 
-                    appendData(batch.vertex, std::span<tga::Vertex>{cubeModel.vertexBuffer});
-                    appendData(batch.index, std::span<uint32_t>{cubeModel.indexBuffer});
+        if (!geometry().buffer || !place(uploads)) {
+            // Out of space or too fragmented: grow and lay out every chunk again
+            size_t neededFaces = meshCache.faceCount();
+            size_t capacity = std::max<size_t>(allocator.capacity(), MIN_HEAP_FACES);
+            while (capacity < neededFaces + neededFaces / 2) capacity *= 2;
+
+            Batch::Element& element = geometry();
+            element.destroy(tgai);
+            element.buffer = tgai.createBuffer({facePulling ? tga::BufferUsage::storage : tga::BufferUsage::vertex,
+                                                capacity * faceBytes()});
+            element.capacity = capacity;
+            allocator.reset(static_cast<uint32_t>(capacity));
+            resident.clear();
+            recreated = true;
+
+            uploads.clear();
+            for (const Chunk* chunk : visibleChunks) {
+                if (const CachedChunkMesh* cached = meshCache.find(chunk->key)) uploads.push_back(cached);
+            }
+            if (!place(uploads)) {
+                throw std::runtime_error("Chunk geometry heap could not be grown enough");
+            }
+        }
 
-                    glm::mat4 modelMatrix = glm::translate(glm::mat4(1.0f), worldPosition);
-                    appendData(batch.modelMatrices, std::span<glm::mat4>{&modelMatrix, 1});
+        size_t drawCount = meshCache.drawCount();
+        recreated |= reserveElement(tgai, batch.drawCommands, tga::BufferUsage::indirect | tga::BufferUsage::storage,
+                                    sizeof(tga::DrawIndexedIndirectCommand), drawCount);
+        recreated |= reserveElement(tgai, batch.modelMatrices, tga::BufferUsage::storage, sizeof(glm::mat4), drawCount);
+        recreated |= reserveElement(tgai, batch.materialIDs, tga::BufferUsage::storage, sizeof(uint32_t), drawCount);
+        recreated |= reserveElement(tgai, batch.boundingBoxes, tga::BufferUsage::storage, sizeof(AABB), drawCount);
+        recreated |= reserveElement(tgai, batch.visibility, tga::BufferUsage::storage, sizeof(uint32_t), drawCount);
+        recreated |= reserveElement(tgai, batch.compactedDraws, tga::BufferUsage::indirect | tga::BufferUsage::storage,
+                                    sizeof(tga::DrawIndexedIndirectCommand), drawCount);
+        recreated |= reserveElement(tgai, batch.lateDraws, tga::BufferUsage::indirect | tga::BufferUsage::storage,
+                                    sizeof(tga::DrawIndexedIndirectCommand), drawCount);
+
+        // Size the staging arena for everything this update writes
+        size_t stagingBytes = StagingArena::aligned(drawCount * sizeof(tga::DrawIndexedIndirectCommand)) +
+                              StagingArena::aligned(drawCount * sizeof(glm::mat4)) +
+                              StagingArena::aligned(drawCount * sizeof(uint32_t)) +
+                              StagingArena::aligned(drawCount * sizeof(AABB)) +
+                              StagingArena::aligned(drawCount * sizeof(uint32_t));
+        for (const CachedChunkMesh* cached : uploads) {
+            stagingBytes += StagingArena::aligned(cached->mesh.faces.size() * faceBytes());
+        }
+        staging.begin(tgai, stagingBytes);
+        lastUploadBytes = stagingBytes;
+
+        // Rewrite the ranges of re-meshed chunks in place
+        for (const CachedChunkMesh* cached : uploads) {
+            const Resident& range = resident.at(cached->chunk->key);
+            const std::vector<FaceQuad>& faces = cached->mesh.faces;
+            if (facePulling) {
+                auto* records = staging.push<FaceRecord>(rec, batch.faces.buffer, range.offset * faceBytes(), faces.size() * faceBytes());
+                for (size_t f = 0; f < faces.size(); ++f) {
+                    records[f] = ChunkMesher::packFace(faces[f]);
+                }
+            } else {
+                auto* vertices = staging.push<PackedVertex>(rec, batch.vertex.buffer, range.offset * faceBytes(), faces.size() * faceBytes());
+                for (size_t f = 0; f < faces.size(); ++f) {
+                    mesher.emitFace(faces[f], vertices + f * ChunkMesher::VERTICES_PER_FACE);
+                }
+            }
+        }
 
-                    tga::DrawIndexedIndirectCommand drawCmd = {
-                        .indexCount = static_cast<uint32_t>(cubeModel.indexBuffer.size()),
+        // One draw per (chunk, block type); geometry is chunk-local and placed by the model matrix
+        auto* drawCommands = staging.push<tga::DrawIndexedIndirectCommand>(rec, batch.drawCommands.buffer, 0, drawCount * sizeof(tga::DrawIndexedIndirectCommand));
+        auto* modelMatrices = staging.push<glm::mat4>(rec, batch.modelMatrices.buffer, 0, drawCount * sizeof(glm::mat4));
+        auto* materialIDs = staging.push<uint32_t>(rec, batch.materialIDs.buffer, 0, drawCount * sizeof(uint32_t));
+        auto* boundingBoxes = staging.push<AABB>(rec, batch.boundingBoxes.buffer, 0, drawCount * sizeof(AABB));
+        // Draw indices change with the list, so every draw starts out as visible
+        auto* visibility = staging.push<uint32_t>(rec, batch.visibility.buffer, 0, drawCount * sizeof(uint32_t));
+        std::fill_n(visibility, drawCount, 1u);
+
+        auto distance2 = [&](const Chunk* chunk) {
+            glm::vec3 center = chunk->position + glm::vec3(CHUNK_SIZE, CHUNK_SIZE_Y, CHUNK_SIZE) * 0.5f;
+            glm::vec3 d = center - cameraPosition;
+            return glm::dot(d, d);
+        };
+
+        std::vector<const Chunk*> order(visibleChunks.begin(), visibleChunks.end());
+        uint32_t drawIndex = 0;
+        for (int layer = 0; layer < RENDER_LAYER_COUNT; ++layer) {
+            // Blending is order dependent, so translucent sub-meshes go far to near
+            if (layer == static_cast<int>(RenderLayer::Translucent)) {
+                std::sort(order.begin(), order.end(), [&](const Chunk* a, const Chunk* b) { return distance2(a) > distance2(b); });
+            }
+            layerDraws[layer].first = drawIndex;
+            for (const Chunk* chunk : order) {
+                const CachedChunkMesh* cached = meshCache.find(chunk->key);
+                if (!cached) continue;
+                const Resident& range = resident.at(chunk->key);
+                glm::mat4 modelMatrix = glm::translate(glm::mat4(1.0f), chunk->position + mesher.cornerOrigin());
+                auto sections = visibleSections.find(chunk->key);
+                uint32_t sectionMask = sections != visibleSections.end() ? sections->second : ~0u;
+
+                const ChunkMesh::Layer& subMesh = cached->mesh.layers[layer];
+                for (uint32_t g = subMesh.firstGroup; g < subMesh.firstGroup + subMesh.groupCount; ++g) {
+                    const ChunkMesh::Group& group = cached->mesh.groups[g];
+                    if (!(sectionMask & (1u << group.section))) continue; // Nothing in it can be seen from the camera
+                    drawCommands[drawIndex] = {
+                        .indexCount = group.faceCount * ChunkMesher::INDICES_PER_FACE,
                         .instanceCount = 1,
-                        .firstIndex = batch.index.count,
-                        .vertexOffset = static_cast<int32_t>(batch.vertex.count),
-                        .firstInstance = batch.modelMatrices.count - 1
+                        .firstIndex = 0,
+                        .vertexOffset = static_cast<int32_t>((range.offset + group.firstFace) * ChunkMesher::VERTICES_PER_FACE),
+                        .firstInstance = drawIndex
                     };
-                    appendData(batch.drawCommands, std::span<tga::DrawIndexedIndirectCommand>{&drawCmd, 1});
-
-                    uint32_t materialID = voxel.type - 1;
-                    appendData(batch.materialIDs, std::span<uint32_t>{&materialID, 1});
-
-                    AABB boundingBox = {glm::vec4(worldPosition, 0), glm::vec4(worldPosition, 0) + glm::vec4(1.0f)};
-                    appendData(batch.boundingBoxes, std::span<AABB>{&boundingBox, 1});
+                    modelMatrices[drawIndex] = modelMatrix;
+                    materialIDs[drawIndex] = group.type - 1;
+                    boundingBoxes[drawIndex] = {glm::vec4(glm::vec3(group.boundsMin), 0.0f), glm::vec4(glm::vec3(group.boundsMax), 0.0f)};
+                    ++drawIndex;
                 }
             }
+            layerDraws[layer].count = drawIndex - layerDraws[layer].first;
         }
+        batch.drawCommands.count = drawIndex;
+        batch.modelMatrices.count = drawIndex;
+        batch.materialIDs.count = drawIndex;
+        batch.boundingBoxes.count = drawIndex;
+        batch.visibility.count = drawIndex;
+
+        return recreated;
     }
 
-    // Finalize buffers
-    auto initBuffer = [&](Batch::Element& element, tga::BufferUsage usage, size_t elementSize) {
-        element.buffer = tgai.createBuffer({usage, elementSize * element.count, element.staging});
-    };
+    // Occupancy of the geometry heap in faces
+    const RangeAllocator& heap() const { return allocator; }
+    size_t uploadedBytes() const { return lastUploadBytes; }
 
-    initBuffer(batch.vertex, tga::BufferUsage::vertex, sizeof(tga::Vertex));
-    initBuffer(batch.index, tga::BufferUsage::index, sizeof(uint32_t));
-    initBuffer(batch.drawCommands, tga::BufferUsage::indirect | tga::BufferUsage::storage, sizeof(tga::DrawIndexedIndirectCommand));
-    initBuffer(batch.modelMatrices, tga::BufferUsage::storage, sizeof(glm::mat4));
-    initBuffer(batch.materialIDs, tga::BufferUsage::storage, sizeof(uint32_t));
-    initBuffer(batch.boundingBoxes, tga::BufferUsage::storage, sizeof(AABB));
+    void destroy(tga::Interface& tgai) {
+        batch.destroy(tgai);
+        batch = {};
+        staging.destroy(tgai);
+        resident.clear();
+        allocator.reset(0);
+    }
 
-    return batch;
-}
+private:
+    struct Resident {
+        uint32_t offset;    // In faces
+        uint32_t faceCount;
+        uint32_t revision;  // CachedChunkMesh::revision that was uploaded
+    };
 
-Batch generateVoxelBatchMined(tga::Obj cubeModel, const std::vector<MinedBlock>& activeMinedBlocks, tga::Interface& tgai, const glm::vec3& playerPosition, int viewDistance, glm::vec3 sunPos, float sunRadius) {
-    Batch batch;
-    
-    batch.textures = allTextures;
-    
-    // Initialize staging buffers with capacity based on the expected number of voxels
-    size_t maxVoxels = activeMinedBlocks.size() + 1;
+    Batch::Element& geometry() { return builtMode == ChunkRenderMode::FacePulling ? batch.faces : batch.vertex; }
 
-    // Calculate max vertices and indices based on the cube model
-    size_t maxVertices =  maxVoxels * cubeModel.vertexBuffer.size();
-    size_t maxIndices = maxVoxels * cubeModel.indexBuffer.size();
+    size_t faceBytes() const {
+        return builtMode == ChunkRenderMode::FacePulling ? sizeof(FaceRecord)
+                                                         : sizeof(PackedVertex) * ChunkMesher::VERTICES_PER_FACE;
+    }
 
-    // Initialize staging buffers
-    auto initStaging = [&](Batch::Element& element, size_t elementSize, size_t maxSize) {
-        element.capacity = maxSize; // Set capacity
-        element.staging = tgai.createStagingBuffer({maxSize * elementSize});
-    };
+    // Gives every mesh a range; false as soon as one does not fit
+    bool place(const std::vector<const CachedChunkMesh*>& meshes) {
+        for (const CachedChunkMesh* cached : meshes) {
+            uint32_t faceCount = static_cast<uint32_t>(cached->mesh.faces.size());
+            std::optional<uint32_t> offset = allocator.allocate(faceCount);
+            if (!offset) return false;
+            resident[cached->chunk->key] = {*offset, faceCount, cached->revision};
+        }
+        return true;
+    }
 
-    // Adjust vertex and index buffer sizes
-    initStaging(batch.vertex, sizeof(tga::Vertex), maxVertices);
-    initStaging(batch.index, sizeof(uint32_t), maxIndices);
-    initStaging(batch.modelMatrices, sizeof(glm::mat4), maxVoxels); // Unchanged
-    initStaging(batch.drawCommands, sizeof(tga::DrawIndexedIndirectCommand), maxVoxels); // Unchanged
-    initStaging(batch.materialIDs, sizeof(uint32_t), maxVoxels); // Unchanged
-    initStaging(batch.boundingBoxes, sizeof(AABB), maxVoxels); // Unchanged
-
-    // Append geometry from the predefined object
-        auto appendData = [&]<typename T>(Batch::Element& elem, std::span<T> span) {
-            if (elem.count + span.size() > elem.capacity) {
-                throw std::runtime_error("Buffer overflow in appendData");
-            }
+    RangeAllocator allocator;
+    std::unordered_map<ChunkKey, Resident, ChunkKeyHasher> resident;
+    ChunkRenderMode builtMode = ChunkRenderMode::PackedVertices;
+    StagingArena staging;
+    size_t lastUploadBytes = 0;
+};
 
-            void* mappedMemory = tgai.getMapping(elem.staging);
-            if (!mappedMemory) {
-                throw std::runtime_error("Failed to map staging buffer");
-            }
+// Dropped blocks, TNT and the sun, drawn as instances of one cube with a single
+// indirect command. The cube is uploaded once; every frame only the instance
+// transforms and material IDs are rewritten in place. The per-instance buffers
+// keep their handles until they have to grow.
+class EntityInstanceBuffer {
+public:
+    static constexpr uint32_t SUN_MATERIAL_ID = 14; // Unique texture ID for the sun
+
+    Batch batch; // Buffers stay valid until update() reports that one was recreated
+
+    // Uploads this frame's instances. Returns true when a buffer handle changed, so
+    // input sets that reference the batch have to be recreated.
+    bool update(tga::Interface& tgai, tga::CommandRecorder& rec, const tga::Obj& cubeModel,
+                const std::vector<MinedBlock>& blocks, const glm::vec3& sunPos, float sunRadius) {
+        bool recreated = false;
+        if (!batch.vertex.buffer) {
+            createStatic(tgai, cubeModel);
+            recreated = true;
+        }
 
-            auto writePos = static_cast<T*>(mappedMemory) + elem.count;
-            std::memcpy(writePos, span.data(), span.size_bytes());
-            elem.count += span.size();
+        size_t instanceCount = blocks.size() + 1; // The sun is the last instance
+        recreated |= reserveElement(tgai, batch.modelMatrices, tga::BufferUsage::storage, sizeof(glm::mat4), instanceCount);
+        recreated |= reserveElement(tgai, batch.materialIDs, tga::BufferUsage::storage, sizeof(uint32_t), instanceCount);
+
+        staging.begin(tgai, StagingArena::aligned(instanceCount * sizeof(glm::mat4)) +
+                                StagingArena::aligned(instanceCount * sizeof(uint32_t)) +
+                                StagingArena::aligned(sizeof(tga::DrawIndexedIndirectCommand)) +
+                                StagingArena::aligned(sizeof(AABB)));
+        auto* modelMatrices = staging.push<glm::mat4>(rec, batch.modelMatrices.buffer, 0, instanceCount * sizeof(glm::mat4));
+        auto* materialIDs = staging.push<uint32_t>(rec, batch.materialIDs.buffer, 0, instanceCount * sizeof(uint32_t));
+
+        AABB bounds = {glm::vec4(sunPos - glm::vec3(sunRadius), 0), glm::vec4(sunPos + glm::vec3(sunRadius), 0)};
+        for (size_t i = 0; i < blocks.size(); ++i) {
+            const MinedBlock& block = blocks[i];
+            modelMatrices[i] = blockMatrix(block);
+            materialIDs[i] = block.type - 1;
+            bounds.min = glm::min(bounds.min, glm::vec4(block.pos, 0));
+            bounds.max = glm::max(bounds.max, glm::vec4(block.pos + glm::vec3(block.tnt ? 2.0f : 1.0f), 0));
+        }
+        modelMatrices[blocks.size()] = sunMatrix(sunPos, sunRadius);
+        materialIDs[blocks.size()] = SUN_MATERIAL_ID;
+
+        // gl_InstanceIndex picks the model matrix and material of each copy
+        *staging.push<tga::DrawIndexedIndirectCommand>(rec, batch.drawCommands.buffer, 0, sizeof(tga::DrawIndexedIndirectCommand)) = {
+            .indexCount = batch.index.count,
+            .instanceCount = static_cast<uint32_t>(instanceCount),
+            .firstIndex = 0,
+            .vertexOffset = 0,
+            .firstInstance = 0
         };
+        *staging.push<AABB>(rec, batch.boundingBoxes.buffer, 0, sizeof(AABB)) = bounds;
 
-    for (auto& block : activeMinedBlocks) {
-        glm::vec3 worldPosition = block.pos;
-        int scale = 1;
-        if(block.tnt){
-            scale = 2;
-        }
+        batch.modelMatrices.count = static_cast<uint32_t>(instanceCount);
+        batch.materialIDs.count = static_cast<uint32_t>(instanceCount);
+        return recreated;
+    }
 
-        // Append vertex and index data
-        appendData(batch.vertex, std::span<tga::Vertex>{cubeModel.vertexBuffer});
-        appendData(batch.index, std::span<uint32_t>{cubeModel.indexBuffer});
+    void destroy(tga::Interface& tgai) {
+        batch.destroy(tgai);
+        batch = {};
+        staging.destroy(tgai);
+    }
 
-        // Compute the model matrix with position and orientation
-        glm::mat4 modelMatrix = glm::translate(glm::mat4(1.0f), worldPosition);
-        modelMatrix = glm::scale(modelMatrix, glm::vec3(scale)); 
+private:
+    // Cube geometry plus the single draw command and its bounds
+    void createStatic(tga::Interface& tgai, const tga::Obj& cubeModel) {
+        batch.textures = allTextures;
+
+        auto upload = [&]<typename T>(Batch::Element& element, tga::BufferUsage usage, const std::vector<T>& data) {
+            size_t size = data.size() * sizeof(T);
+            auto elementStaging = tgai.createStagingBuffer({size, tga::memoryAccess(data)});
+            element.buffer = tgai.createBuffer({usage, size, elementStaging});
+            element.capacity = data.size();
+            element.count = static_cast<uint32_t>(data.size());
+            tgai.free(elementStaging);
+        };
+        upload(batch.vertex, tga::BufferUsage::vertex, cubeModel.vertexBuffer);
+        upload(batch.index, tga::BufferUsage::index, cubeModel.indexBuffer);
+
+        batch.drawCommands.buffer = tgai.createBuffer({tga::BufferUsage::indirect | tga::BufferUsage::storage,
+                                                       sizeof(tga::DrawIndexedIndirectCommand)});
+        batch.drawCommands.capacity = batch.drawCommands.count = 1;
+        batch.boundingBoxes.buffer = tgai.createBuffer({tga::BufferUsage::storage, sizeof(AABB)});
+        batch.boundingBoxes.capacity = batch.boundingBoxes.count = 1;
+    }
 
-        // Apply rotation based on the block's orientation
+    // Item position and tumbling orientation; TNT is drawn twice the size
+    static glm::mat4 blockMatrix(const MinedBlock& block) {
+        glm::mat4 modelMatrix = glm::translate(glm::mat4(1.0f), block.pos);
+        modelMatrix = glm::scale(modelMatrix, glm::vec3(block.tnt ? 2.0f : 1.0f));
         modelMatrix *= glm::rotate(glm::mat4(1.0f), block.orientation.x, glm::vec3(1, 0, 0));
         modelMatrix *= glm::rotate(glm::mat4(1.0f), block.orientation.y, glm::vec3(0, 1, 0));
         modelMatrix *= glm::rotate(glm::mat4(1.0f), block.orientation.z, glm::vec3(0, 0, 1));
-
-        // Append model matrix for this voxel
-        appendData(batch.modelMatrices, std::span<glm::mat4>{&modelMatrix, 1});
-
-        // Append draw command for this voxel
-        tga::DrawIndexedIndirectCommand drawCmd = {
-            .indexCount = static_cast<uint32_t>(cubeModel.indexBuffer.size()),
-            .instanceCount = 1,
-            .firstIndex = static_cast<uint32_t>(batch.index.count),
-            .vertexOffset = static_cast<int32_t>(batch.vertex.count),
-            .firstInstance = batch.modelMatrices.count
-        };
-        appendData(batch.drawCommands, std::span<tga::DrawIndexedIndirectCommand>{&drawCmd, 1});
-
-        // Append material ID for this voxel
-        uint32_t materialID = block.type - 1; // Use voxel type (1 = grass, 2 = stone, 3 = bedrock)
-        appendData(batch.materialIDs, std::span<uint32_t>{&materialID, 1});
-
-        // Append bounding box for this voxel
-        AABB boundingBox = {glm::vec4(worldPosition, 0), glm::vec4(worldPosition, 0) + glm::vec4(1.0f)};
-        appendData(batch.boundingBoxes, std::span<AABB>{&boundingBox, 1});
+        return modelMatrix;
     }
 
-    appendData(batch.vertex, std::span<tga::Vertex>{cubeModel.vertexBuffer});
-    appendData(batch.index, std::span<uint32_t>{cubeModel.indexBuffer});
-
-    // Compute the direction vector from the sun to the origin
-    glm::vec3 direction = glm::normalize(-sunPos);
-
-    // Define the fixed "up" vector
-    glm::vec3 up = glm::vec3(0.0f, 1.0f, 0.0f);
-
-    // Compute the right vector (cross product of up and direction)
-    glm::vec3 right = glm::normalize(glm::cross(up, direction));
-
-    // Recompute the corrected "up" vector to ensure orthogonality
-    glm::vec3 correctedUp = glm::cross(direction, right);
-
-    // Construct the rotation matrix manually
-    glm::mat4 rotationMatrix = glm::mat4(
-        glm::vec4(right, 0.0f),
-        glm::vec4(correctedUp, 0.0f),
-        glm::vec4(-direction, 0.0f),
-        glm::vec4(0.0f, 0.0f, 0.0f, 1.0f)
-    );
-
-    // Create the sun model matrix
-    glm::mat4 sunModelMatrix = glm::translate(glm::mat4(1.0f), sunPos);
-    sunModelMatrix *= rotationMatrix; // Apply the rotation
-    sunModelMatrix = glm::scale(sunModelMatrix, glm::vec3(sunRadius)); // Apply scaling
+    // Sun cube turned to face the origin
+    static glm::mat4 sunMatrix(const glm::vec3& sunPos, float sunRadius) {
+        glm::vec3 direction = glm::normalize(-sunPos);
+        glm::vec3 up = glm::vec3(0.0f, 1.0f, 0.0f);
+        glm::vec3 right = glm::normalize(glm::cross(up, direction));
+        glm::vec3 correctedUp = glm::cross(direction, right); // Keeps the basis orthogonal
+
+        glm::mat4 rotationMatrix = glm::mat4(
+            glm::vec4(right, 0.0f),
+            glm::vec4(correctedUp, 0.0f),
+            glm::vec4(-direction, 0.0f),
+            glm::vec4(0.0f, 0.0f, 0.0f, 1.0f)
+        );
+
+        glm::mat4 sunModelMatrix = glm::translate(glm::mat4(1.0f), sunPos);
+        sunModelMatrix *= rotationMatrix;
+        return glm::scale(sunModelMatrix, glm::vec3(sunRadius));
+    }
 
+    StagingArena staging;
+};
 
-    appendData(batch.modelMatrices, std::span<glm::mat4>{&sunModelMatrix, 1});
+// Hierarchical depth buffer for occlusion culling. Level 0 is half the G-buffer
+// resolution and every further level halves again down to a single texel. A texel
+// keeps the furthest view depth of the pixels below it, so a box whose nearest point
+// lies behind every texel under its screen rectangle is hidden. TGA textures have no
+// mip chain, so all levels are packed into one storage buffer.
+class DepthPyramid {
+public:
+    static constexpr uint32_t MAX_LEVELS = 16;
+    static constexpr uint32_t GROUP_SIZE = 8; // depth_pyramid.comp local size
+
+    // Level block of depth_pyramid.comp
+    struct Level {
+        glm::uvec2 srcSize;
+        uint32_t srcOffset;
+        uint32_t fromGBuffer;
+        glm::uvec2 dstSize;
+        uint32_t dstOffset;
+        uint32_t padding;
+    };
 
-    tga::DrawIndexedIndirectCommand sunDrawCmd = {
-        .indexCount = static_cast<uint32_t>(cubeModel.indexBuffer.size()),
-        .instanceCount = 1,
-        .firstIndex = batch.index.count,
-        .vertexOffset = static_cast<int32_t>(batch.vertex.count),
-        .firstInstance = batch.modelMatrices.count - 1
+    // PyramidLevels block of occlusion_culling.comp
+    struct alignas(16) LevelTable {
+        std::array<glm::uvec4, MAX_LEVELS> levels; // xy = size, z = offset of the first texel
+        glm::uvec2 screenSize;
+        uint32_t levelCount;
     };
-    appendData(batch.drawCommands, std::span<tga::DrawIndexedIndirectCommand>{&sunDrawCmd, 1});
 
-    uint32_t sunMaterialID = 14; // Unique texture ID for the sun
-    appendData(batch.materialIDs, std::span<uint32_t>{&sunMaterialID, 1});
+    tga::Buffer texels;     // Every level, back to back
+    tga::Buffer levelTable; // LevelTable, read by the occlusion test
+
+    // Lays out the levels for a G-buffer of width x height and creates one input set
+    // per level for the build pass
+    void create(tga::Interface& tgai, tga::ComputePass buildPass, uint32_t width, uint32_t height,
+                tga::Buffer camBuffer, tga::Texture positionTex, tga::Texture normalTex) {
+        LevelTable table{};
+        table.screenSize = glm::uvec2(width, height);
+        glm::uvec2 srcSize(width, height);
+        uint32_t srcOffset = 0;
+        uint32_t texelCount = 0;
+        while (levels.size() < MAX_LEVELS) {
+            glm::uvec2 dstSize((srcSize.x + 1) / 2, (srcSize.y + 1) / 2);
+            levels.push_back({srcSize, srcOffset, levels.empty() ? 1u : 0u, dstSize, texelCount, 0});
+            table.levels[levels.size() - 1] = glm::uvec4(dstSize.x, dstSize.y, texelCount, 0);
+            srcSize = dstSize;
+            srcOffset = texelCount;
+            texelCount += dstSize.x * dstSize.y;
+            if (dstSize.x == 1 && dstSize.y == 1) break;
+        }
+        table.levelCount = static_cast<uint32_t>(levels.size());
+
+        texels = tgai.createBuffer({tga::BufferUsage::storage, texelCount * sizeof(float)});
+        auto tableStaging = tgai.createStagingBuffer({sizeof(LevelTable), tga::memoryAccess(table)});
+        levelTable = tgai.createBuffer({tga::BufferUsage::uniform, sizeof(LevelTable), tableStaging});
+        tgai.free(tableStaging);
+
+        for (const Level& level : levels) {
+            auto levelStaging = tgai.createStagingBuffer({sizeof(Level), tga::memoryAccess(level)});
+            levelBuffers.push_back(tgai.createBuffer({tga::BufferUsage::uniform, sizeof(Level), levelStaging}));
+            tgai.free(levelStaging);
+            levelInputs.push_back(tgai.createInputSet(
+                {buildPass,
+                 {tga::Binding{camBuffer, 0}, tga::Binding{positionTex, 1}, tga::Binding{normalTex, 2},
+                  tga::Binding{texels, 3}, tga::Binding{levelBuffers.back(), 4}}}));
+        }
+    }
 
-    AABB sunBoundingBox = {glm::vec4(sunPos - glm::vec3(sunRadius), 0), glm::vec4(sunPos + glm::vec3(sunRadius), 0)};
-    appendData(batch.boundingBoxes, std::span<AABB>{&sunBoundingBox, 1});
+    // Reduces the G-buffer level by level; the G-buffer has to be written before
+    void build(tga::CommandRecorder& rec, tga::ComputePass buildPass) const {
+        for (size_t i = 0; i < levels.size(); ++i) {
+            rec.setComputePass(buildPass);
+            rec.bindInputSet(levelInputs[i]);
+            rec.dispatch((levels[i].dstSize.x + GROUP_SIZE - 1) / GROUP_SIZE, (levels[i].dstSize.y + GROUP_SIZE - 1) / GROUP_SIZE, 1);
+            // The next level reads this one
+            rec.barrier(tga::PipelineStage::ComputeShader, tga::PipelineStage::ComputeShader);
+        }
+    }
 
-    // Finalize staging buffers
-    auto initBuffer = [&](Batch::Element& element, tga::BufferUsage usage, size_t elementSize) {
-        element.buffer = tgai.createBuffer({usage, elementSize * element.count, element.staging});
-    };
+    void destroy(tga::Interface& tgai) {
+        for (tga::InputSet& input : levelInputs) tgai.free(input);
+        for (tga::Buffer& buffer : levelBuffers) tgai.free(buffer);
+        if (texels) tgai.free(texels);
+        if (levelTable) tgai.free(levelTable);
+        levelInputs.clear();
+        levelBuffers.clear();
+        levels.clear();
+        texels = {};
+        levelTable = {};
+    }
 
-    initBuffer(batch.vertex, tga::BufferUsage::vertex, sizeof(tga::Vertex));
-    initBuffer(batch.index, tga::BufferUsage::index, sizeof(uint32_t));
-    initBuffer(batch.drawCommands, tga::BufferUsage::indirect | tga::BufferUsage::storage, sizeof(tga::DrawIndexedIndirectCommand));
-    initBuffer(batch.modelMatrices, tga::BufferUsage::storage, sizeof(glm::mat4));
-    initBuffer(batch.materialIDs, tga::BufferUsage::storage, sizeof(uint32_t));
-    initBuffer(batch.boundingBoxes, tga::BufferUsage::storage, sizeof(AABB));
-    return batch;
-}
\ No newline at end of file
+private:
+    std::vector<Level> levels;
+    std::vector<tga::Buffer> levelBuffers;
+    std::vector<tga::InputSet> levelInputs;
+};
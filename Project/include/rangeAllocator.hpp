@@ -0,0 +1,80 @@
+#pragma once
+#include <algorithm>
+#include <cstdint>
+#include <iterator>
+#include <map>
+#include <optional>
+
+// First-fit free-list allocator over [0, capacity) in abstract units. Freed ranges
+// are merged with their neighbours so the list only holds real gaps. Used to place
+// chunk meshes in one long-lived GPU buffer.
+class RangeAllocator {
+public:
+    explicit RangeAllocator(uint32_t capacity = 0) { reset(capacity); }
+
+    // Forgets every allocation and makes [0, capacity) one free block
+    void reset(uint32_t capacity) {
+        total = capacity;
+        used = 0;
+        freeBlocks.clear();
+        if (capacity > 0) freeBlocks[0] = capacity;
+    }
+
+    std::optional<uint32_t> allocate(uint32_t size) {
+        if (size == 0) return 0;
+        for (auto it = freeBlocks.begin(); it != freeBlocks.end(); ++it) {
+            if (it->second < size) continue;
+            uint32_t offset = it->first;
+            uint32_t remaining = it->second - size;
+            freeBlocks.erase(it);
+            if (remaining > 0) freeBlocks[offset + size] = remaining;
+            used += size;
+            return offset;
+        }
+        return std::nullopt;
+    }
+
+    void free(uint32_t offset, uint32_t size) {
+        if (size == 0) return;
+        used -= size;
+        auto next = freeBlocks.lower_bound(offset);
+
+        // Merge with the block that ends where this one starts
+        if (next != freeBlocks.begin()) {
+            auto prev = std::prev(next);
+            if (prev->first + prev->second == offset) {
+                offset = prev->first;
+                size += prev->second;
+                freeBlocks.erase(prev);
+            }
+        }
+        // Merge with the block that starts where this one ends
+        if (next != freeBlocks.end() && offset + size == next->first) {
+            size += next->second;
+            freeBlocks.erase(next);
+        }
+        freeBlocks[offset] = size;
+    }
+
+    uint32_t capacity() const { return total; }
+    uint32_t usedUnits() const { return used; }
+    uint32_t freeUnits() const { return total - used; }
+    size_t freeBlockCount() const { return freeBlocks.size(); }
+
+    uint32_t largestFreeBlock() const {
+        uint32_t largest = 0;
+        for (const auto& [offset, size] : freeBlocks) largest = std::max(largest, size);
+        return largest;
+    }
+
+    // 0 when all free space is one block, towards 1 when it is split into many small gaps
+    float fragmentation() const {
+        uint32_t freeSpace = freeUnits();
+        return freeSpace == 0 ? 0.0f : 1.0f - static_cast<float>(largestFreeBlock()) / freeSpace;
+    }
+
+private:
+    std::map<uint32_t, uint32_t> freeBlocks; // offset -> size
+    uint32_t total = 0;
+    uint32_t used = 0;
+};
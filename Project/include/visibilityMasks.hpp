@@ -0,0 +1,108 @@
+#pragma once
+#include "chunk.hpp"
+
+// Whole-chunk visibility from the chunk occupancy masks. Each 64-bit word holds
+// four x-rows of one layer, so shifting by 1 steps along x, shifting by 16 steps
+// along z and moving by WORDS_PER_LAYER words steps along y. Border rows of the
+// horizontal neighbours are read straight from their masks.
+namespace VisibilityMasks {
+
+constexpr int WORDS_PER_LAYER = CHUNK_SIZE * CHUNK_SIZE / 64;
+constexpr int WORD_COUNT = CHUNK_VOLUME / 64;
+constexpr uint64_t ROW_FIRST_BITS = 0x0001000100010001ULL; // x == 0 of every row
+constexpr uint64_t ROW_LAST_BITS = 0x8000800080008000ULL;  // x == 15 of every row
+
+// Horizontal neighbour chunks; a missing one hides the faces towards it
+struct Neighbours {
+    const Chunk* px = nullptr;
+    const Chunk* nx = nullptr;
+    const Chunk* pz = nullptr;
+    const Chunk* nz = nullptr;
+};
+
+// Horizontal neighbour masks, for callers that hold copies instead of chunks
+struct NeighbourMasks {
+    const VoxelMask* px = nullptr;
+    const VoxelMask* nx = nullptr;
+    const VoxelMask* pz = nullptr;
+    const VoxelMask* nz = nullptr;
+};
+
+// Reads a mask word, optionally inverted. Missing masks read as 0.
+template <bool Invert>
+inline uint64_t load(const VoxelMask* mask, int w) {
+    if (!mask) return 0;
+    uint64_t word = (*mask)[w];
+    return Invert ? ~word : word;
+}
+
+// Bit set where the neighbour across each face (+x, -x, +y, -y, +z, -z) has its mask bit set.
+// Only the border rows of the neighbour masks are read.
+template <bool Invert>
+inline std::array<uint64_t, 6> neighbourWords(const VoxelMask& mask, const NeighbourMasks& n, int w, uint64_t aboveTop) {
+    int y = w / WORDS_PER_LAYER;
+    int row = w % WORDS_PER_LAYER;
+    uint64_t m = load<Invert>(&mask, w);
+
+    uint64_t nextRows = row + 1 < WORDS_PER_LAYER ? load<Invert>(&mask, w + 1)
+                                                  : load<Invert>(n.pz, w - row);
+    uint64_t prevRows = row > 0 ? load<Invert>(&mask, w - 1)
+                                : load<Invert>(n.nz, w + WORDS_PER_LAYER - 1);
+    return {
+        ((m >> 1) & ~ROW_LAST_BITS) | ((load<Invert>(n.px, w) & ROW_FIRST_BITS) << 15),
+        ((m << 1) & ~ROW_FIRST_BITS) | ((load<Invert>(n.nx, w) & ROW_LAST_BITS) >> 15),
+        y + 1 < CHUNK_SIZE_Y ? load<Invert>(&mask, w + WORDS_PER_LAYER) : aboveTop,
+        y > 0 ? load<Invert>(&mask, w - WORDS_PER_LAYER) : 0,
+        (m >> 16) | (nextRows << 48),
+        (m << 16) | (prevRows >> 48),
+    };
+}
+
+// Same as above with the mask selected from the chunk and its neighbours
+template <const VoxelMask& (Chunk::*Mask)() const, bool Invert>
+inline std::array<uint64_t, 6> neighbourWords(const Chunk& chunk, const Neighbours& n, int w, uint64_t aboveTop) {
+    auto maskOf = [](const Chunk* c) { return c ? &(c->*Mask)() : nullptr; };
+    return neighbourWords<Invert>((chunk.*Mask)(), {maskOf(n.px), maskOf(n.nx), maskOf(n.pz), maskOf(n.nz)}, w, aboveTop);
+}
+
+// Recomputes every visibility bit of the chunk. Opaque blocks are visible when any
+// face touches air, water or leaves, ores always, water always. Water voxels also get
+// their faceMask (faces touching air) refreshed. Above the chunk counts as air.
+inline void update(Chunk& chunk, const Neighbours& n) {
+    constexpr uint64_t ALL = ~uint64_t(0);
+    const VoxelMask& opaque = chunk.opaqueMask();
+    const VoxelMask& ores = chunk.alwaysVisibleMask();
+    const VoxelMask& fluid = chunk.fluidMask();
+
+    VoxelMask visible{};
+    for (int w = 0; w < WORD_COUNT; ++w) {
+        uint64_t water = fluid[w];
+        if (opaque[w] == 0 && water == 0) continue; // Only air in these rows
+
+        auto open = neighbourWords<&Chunk::hidingMask, true>(chunk, n, w, ALL);
+        uint64_t exposed = open[0] | open[1] | open[2] | open[3] | open[4] | open[5];
+        visible[w] = (opaque[w] & exposed) | ores[w] | water;
+
+        if (water == 0) continue;
+        auto airFaces = neighbourWords<&Chunk::airMask, false>(chunk, n, w, ALL);
+        for (uint64_t bits = water; bits; bits &= bits - 1) {
+            int bit = std::countr_zero(bits);
+            uint8_t faceMask = 0;
+            for (int f = 0; f < 6; ++f) {
+                faceMask |= ((airFaces[f] >> bit) & 1u) << f;
+            }
+            int i = w * 64 + bit;
+            int x = i % CHUNK_SIZE;
+            int z = (i / CHUNK_SIZE) % CHUNK_SIZE;
+            int y = i / (CHUNK_SIZE * CHUNK_SIZE);
+            VoxelMeta meta = chunk.getMeta(x, y, z);
+            if (meta.faceMask != faceMask) {
+                meta.faceMask = faceMask;
+                chunk.setMeta(x, y, z, meta);
+            }
+        }
+    }
+    chunk.setVisibleMask(visible);
+}
+
+} // namespace VisibilityMasks
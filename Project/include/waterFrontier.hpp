@@ -0,0 +1,71 @@
+#pragma once
+#include <cstdint>
+#include <deque>
+#include <unordered_map>
+#include "chunk.hpp"
+
+// Water cells waiting to flow, oldest first. Cells are kept as packed integer keys,
+// and a bit per voxel of each chunk keeps a cell from being queued twice. Each tick
+// takes at most a budget of cells off the front, so a large flood spreads over
+// several ticks instead of stalling one frame.
+class WaterFrontier {
+public:
+    struct Cell {
+        uint64_t key; // pack(position)
+        int sourceID;
+        int travelDistance; // Sideways steps since the flow last fell
+    };
+
+    // x and z keep 28 bits each, y the low 8
+    static uint64_t pack(const glm::ivec3& position) {
+        return uint64_t(uint32_t(position.x) & 0xFFFFFFF) << 36 | uint64_t(uint32_t(position.z) & 0xFFFFFFF) << 8 |
+               uint64_t(uint32_t(position.y) & 0xFF);
+    }
+
+    static glm::ivec3 unpack(uint64_t key) {
+        auto signExtend = [](uint64_t bits) { return static_cast<int>(static_cast<int32_t>(uint32_t(bits) << 4) >> 4); };
+        return glm::ivec3(signExtend(key >> 36), static_cast<int>(key & 0xFF), signExtend((key >> 8) & 0xFFFFFFF));
+    }
+
+    // False when the cell is already queued or lies above or below the world
+    bool push(const glm::ivec3& position, int sourceID, int travelDistance) {
+        if (position.y < 0 || position.y >= CHUNK_SIZE_Y) return false;
+        VoxelMask& mask = queued[{position.x >> CHUNK_SHIFT, position.z >> CHUNK_SHIFT}];
+        int bit = Chunk::index(position.x & CHUNK_MASK, position.y, position.z & CHUNK_MASK);
+        uint64_t& word = mask[bit >> 6];
+        if ((word >> (bit & 63)) & 1u) return false;
+        word |= uint64_t(1) << (bit & 63);
+        cells.push_back({pack(position), sourceID, travelDistance});
+        return true;
+    }
+
+    // Hands up to budget cells to visit(position, sourceID, travelDistance), which may
+    // push new cells; those wait for a later call. Returns the number of cells visited.
+    template <typename Visit>
+    size_t process(size_t budget, Visit visit) {
+        size_t count = std::min(budget, cells.size());
+        for (size_t i = 0; i < count; ++i) {
+            Cell cell = cells.front();
+            cells.pop_front();
+            glm::ivec3 position = unpack(cell.key);
+            int bit = Chunk::index(position.x & CHUNK_MASK, position.y, position.z & CHUNK_MASK);
+            queued[{position.x >> CHUNK_SHIFT, position.z >> CHUNK_SHIFT}][bit >> 6] &= ~(uint64_t(1) << (bit & 63));
+            visit(position, cell.sourceID, cell.travelDistance);
+        }
+        if (cells.empty()) queued.clear(); // Every bit is clear again
+        return count;
+    }
+
+    const std::deque<Cell>& pending() const { return cells; }
+    bool empty() const { return cells.empty(); }
+    size_t size() const { return cells.size(); }
+
+    void clear() {
+        cells.clear();
+        queued.clear();
+    }
+
+private:
+    std::deque<Cell> cells;
+    std::unordered_map<ChunkKey, VoxelMask, ChunkKeyHasher> queued;
+};
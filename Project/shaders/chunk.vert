@@ -0,0 +1,61 @@
+#version 460
+
+// Packed chunk vertex, see PackedVertex in chunkMesher.hpp
+//   x: position (x 5 bits, y 6 bits, z 5 bits, face 3 bits, ao 2 bits)
+//   y: attributes (u 6 bits, v 6 bits, block type 8 bits)
+layout(location = 0) in uvec2 packedVertex;
+
+layout(set = 0, binding = 0) uniform CameraData{
+    mat4 view;
+    mat4 toWorld;
+    mat4 projection;
+}camera;
+
+layout(set = 1, binding = 0) readonly buffer ModelData{
+    mat4 at[];
+}modelMatrices;
+
+// PackedFaceTemplate per face, in +x, -x, +y, -y, +z, -z order
+struct FaceTemplate {
+    vec2 tileOrigin;
+    uint corners;
+    uint widthUVAxis;
+};
+
+layout(set = 1, binding = 3) readonly buffer FaceTemplates{
+    FaceTemplate at[6];
+}faceTemplates;
+
+layout (location = 0) out FragData{
+    vec3 worldPosition;
+    vec2 texCoords;
+    vec3 normal;
+    vec3 tangent; // xy = atlas origin of the face's tile
+    flat uint textureID;
+    float ao;
+} fragData;
+
+// Brightness per baked AO level, 0 = corner fully enclosed
+const float AO_CURVE[4] = float[](0.45, 0.6, 0.8, 1.0);
+
+const vec3 FACE_NORMALS[6] = vec3[](
+    vec3(1, 0, 0), vec3(-1, 0, 0), vec3(0, 1, 0), vec3(0, -1, 0), vec3(0, 0, 1), vec3(0, 0, -1)
+);
+
+void main(){
+    uint position = packedVertex.x;
+    uint attributes = packedVertex.y;
+    vec3 corner = vec3(position & 31u, (position >> 5) & 63u, (position >> 11) & 31u);
+    uint face = (position >> 16) & 7u;
+
+    mat4 modelMatrix = modelMatrices.at[gl_InstanceIndex];
+    vec4 wPos = modelMatrix * vec4(corner, 1);
+    fragData.worldPosition = wPos.xyz;
+
+    fragData.texCoords = vec2(attributes & 63u, (attributes >> 6) & 63u);
+    fragData.normal = mat3(modelMatrix) * FACE_NORMALS[face];
+    fragData.tangent = vec3(faceTemplates.at[face].tileOrigin, 0);
+    fragData.textureID = ((attributes >> 12) & 255u) - 1u; // Block type to material
+    fragData.ao = AO_CURVE[(position >> 19) & 3u];
+    gl_Position = camera.projection * camera.view * wPos;
+}
@@ -0,0 +1,84 @@
+#version 460
+
+// Vertex pulling for chunk faces: no vertex input, every quad is one FaceRecord
+// (see chunkMesher.hpp) and the shared quad indices give
+// gl_VertexIndex = face * 4 + corner.
+
+layout(set = 0, binding = 0) uniform CameraData{
+    mat4 view;
+    mat4 toWorld;
+    mat4 projection;
+}camera;
+
+layout(set = 1, binding = 0) readonly buffer ModelData{
+    mat4 at[];
+}modelMatrices;
+
+// PackedFaceTemplate per face, in +x, -x, +y, -y, +z, -z order
+struct FaceTemplate {
+    vec2 tileOrigin;
+    uint corners;
+    uint widthUVAxis;
+};
+
+layout(set = 1, binding = 3) readonly buffer FaceTemplates{
+    FaceTemplate at[6];
+}faceTemplates;
+
+// x: origin voxel (x 5 bits, y 6 bits, z 5 bits, face 3 bits), corner ao (4 x 2 bits), diagonal flip (1 bit)
+// y: extent (width 6 bits, height 6 bits, block type 8 bits)
+layout(set = 1, binding = 4) readonly buffer FaceRecords{
+    uvec2 at[];
+}faceRecords;
+
+layout (location = 0) out FragData{
+    vec3 worldPosition;
+    vec2 texCoords;
+    vec3 normal;
+    vec3 tangent; // xy = atlas origin of the face's tile
+    flat uint textureID;
+    float ao;
+} fragData;
+
+// Brightness per baked AO level, 0 = corner fully enclosed
+const float AO_CURVE[4] = float[](0.45, 0.6, 0.8, 1.0);
+
+const vec3 FACE_NORMALS[6] = vec3[](
+    vec3(1, 0, 0), vec3(-1, 0, 0), vec3(0, 1, 0), vec3(0, -1, 0), vec3(0, 0, 1), vec3(0, 0, -1)
+);
+
+// In-plane (width, height) axes of each face, must match FACE_AXES in chunkMesher.cpp
+const ivec2 FACE_AXES[6] = ivec2[](
+    ivec2(2, 1), ivec2(2, 1), ivec2(0, 2), ivec2(0, 2), ivec2(0, 1), ivec2(0, 1)
+);
+
+void main(){
+    uvec2 record = faceRecords.at[gl_VertexIndex >> 2];
+    // A flipped quad starts one corner later, moving the shared diagonal
+    uint cornerID = ((uint(gl_VertexIndex) & 3u) + ((record.x >> 27) & 1u)) & 3u;
+
+    uint face = (record.x >> 16) & 7u;
+    vec3 origin = vec3(record.x & 31u, (record.x >> 5) & 63u, (record.x >> 11) & 31u);
+    vec2 extent = vec2(record.y & 63u, (record.y >> 6) & 63u);
+
+    // Stretch the unit face template over the quad and repeat the tile
+    FaceTemplate faceTemplate = faceTemplates.at[face];
+    uint bits = (faceTemplate.corners >> (5u * cornerID)) & 31u;
+    vec3 corner = vec3(bits & 1u, (bits >> 1) & 1u, (bits >> 2) & 1u);
+    vec2 uv = vec2((bits >> 3) & 1u, (bits >> 4) & 1u);
+    corner[FACE_AXES[face].x] *= extent.x;
+    corner[FACE_AXES[face].y] *= extent.y;
+    uv[faceTemplate.widthUVAxis] *= extent.x;
+    uv[1 - faceTemplate.widthUVAxis] *= extent.y;
+
+    mat4 modelMatrix = modelMatrices.at[gl_InstanceIndex];
+    vec4 wPos = modelMatrix * vec4(origin + corner, 1);
+    fragData.worldPosition = wPos.xyz;
+
+    fragData.texCoords = uv;
+    fragData.normal = mat3(modelMatrix) * FACE_NORMALS[face];
+    fragData.tangent = vec3(faceTemplate.tileOrigin, 0);
+    fragData.textureID = ((record.y >> 12) & 255u) - 1u; // Block type to material
+    fragData.ao = AO_CURVE[(record.x >> (19u + 2u * cornerID)) & 3u];
+    gl_Position = camera.projection * camera.view * wPos;
+}
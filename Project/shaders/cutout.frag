@@ -0,0 +1,37 @@
+#version 460
+#extension GL_EXT_nonuniform_qualifier: enable
+
+// Alpha-tested chunk faces (leaves). Same as fs.frag, but texels below half alpha
+// are discarded. Kept out of fs.frag so the opaque pass has no discard and keeps
+// early depth testing.
+
+layout (location = 0) in FragData {
+    vec3 worldPosition;
+    vec2 texCoords;
+    vec3 normal;
+    vec3 tangent; // xy = atlas origin of the face's tile
+    flat uint textureID;
+    float ao;
+} fragData;
+
+layout(set = 1, binding = 2) uniform sampler2D colorTex[];
+
+// Size of one face tile in the cube-net texture, must match ChunkMesher::TILE_SIZE_U/V
+const vec2 TILE_SIZE = vec2(0.332826, 0.249619);
+
+layout(location = 0) out vec4 albedo;
+layout(location = 1) out vec4 normal; // w = baked ambient occlusion
+layout(location = 2) out vec3 position;
+
+void main() {
+    vec2 atlasUV = fragData.tangent.xy + fract(fragData.texCoords) * TILE_SIZE;
+    vec4 color = textureGrad(colorTex[fragData.textureID], atlasUV,
+                             dFdx(fragData.texCoords) * TILE_SIZE, dFdy(fragData.texCoords) * TILE_SIZE);
+    if (color.a < 0.5) {
+        discard;
+    }
+    albedo = vec4(color.rgb, 1.0);
+
+    normal = vec4(normalize(fragData.normal), fragData.ao);
+    position = fragData.worldPosition;
+}
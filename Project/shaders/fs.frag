@@ -5,14 +5,18 @@ layout (location = 0) in FragData {
     vec3 worldPosition;
     vec2 texCoords;
     vec3 normal;
-    vec3 tangent; // Unused
-    uint textureID;
+    vec3 tangent; // xy = atlas origin of the face's tile
+    flat uint textureID;
+    float ao;
 } fragData;
 
 
 
 layout(set = 1, binding = 2) uniform sampler2D colorTex[];
 
+// Size of one face tile in the cube-net texture, must match ChunkMesher::TILE_SIZE_U/V
+const vec2 TILE_SIZE = vec2(0.332826, 0.249619);
+
 layout(set = 0, binding = 0) uniform CameraData {
     mat4 view;
     mat4 toWorld;
@@ -21,18 +25,18 @@ layout(set = 0, binding = 0) uniform CameraData {
 };
 
 layout(location = 0) out vec4 albedo;
-layout(location = 1) out vec3 normal;
+layout(location = 1) out vec4 normal; // w = baked ambient occlusion
 layout(location = 2) out vec3 position;
 
 void main() {
-    // Texture lookup and other fragment processing
-    if (fragData.textureID == 9) {
-        albedo = vec4(texture(colorTex[fragData.textureID], fragData.texCoords).rgb, 0.1);
-    } else {
-        albedo = vec4(texture(colorTex[fragData.textureID], fragData.texCoords).rgb, 1.0);
-    }
-
-    normal = normalize(fragData.normal); // TODO: Normal mapping
+    // texCoords count tiles, so greedy quads repeat the face tile instead of stretching it.
+    // Gradients come from the unwrapped coordinates to avoid mip seams at tile edges.
+    vec2 atlasUV = fragData.tangent.xy + fract(fragData.texCoords) * TILE_SIZE;
+    vec3 color = textureGrad(colorTex[fragData.textureID], atlasUV,
+                             dFdx(fragData.texCoords) * TILE_SIZE, dFdy(fragData.texCoords) * TILE_SIZE).rgb;
+    albedo = vec4(color, 1.0); // Opaque layer, see cutout.frag and translucent.frag for the others
+
+    normal = vec4(normalize(fragData.normal), fragData.ao); // TODO: Normal mapping
     position = fragData.worldPosition;
     
     
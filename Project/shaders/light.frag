@@ -36,7 +36,9 @@ void main() {
     }
 
     // Step 2: Lighting computations
-    vec3 N = normalize(texture(normal, fragData.uv).xyz); // Normal from G-buffer
+    vec4 normalAO = texture(normal, fragData.uv);
+    vec3 N = normalize(normalAO.xyz);                     // Normal from G-buffer
+    float ao = normalAO.w;                                // Baked corner occlusion, 1 = open
     vec3 P = texture(position, fragData.uv).xyz;          // World position from G-buffer
     vec3 L = normalize(sunlight.direction);              // Light direction
     vec3 V = normalize(camera.cameraPosition - P);       // View direction
@@ -50,6 +52,6 @@ void main() {
 
   
     // Combine lighting with shadow factor
-    vec3 finalColor = ambient + diffuse;
+    vec3 finalColor = (ambient + diffuse) * ao;
     color = vec4(finalColor, objectColor.a);
 }
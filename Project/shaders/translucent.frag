@@ -0,0 +1,35 @@
+#version 460
+#extension GL_EXT_nonuniform_qualifier: enable
+
+// Translucent chunk faces (water). Drawn last with blending enabled, chunk by
+// chunk from back to front.
+
+layout (location = 0) in FragData {
+    vec3 worldPosition;
+    vec2 texCoords;
+    vec3 normal;
+    vec3 tangent; // xy = atlas origin of the face's tile
+    flat uint textureID;
+    float ao;
+} fragData;
+
+layout(set = 1, binding = 2) uniform sampler2D colorTex[];
+
+// Size of one face tile in the cube-net texture, must match ChunkMesher::TILE_SIZE_U/V
+const vec2 TILE_SIZE = vec2(0.332826, 0.249619);
+
+const float WATER_ALPHA = 0.6;
+
+layout(location = 0) out vec4 albedo;
+layout(location = 1) out vec4 normal; // w = baked ambient occlusion
+layout(location = 2) out vec3 position;
+
+void main() {
+    vec2 atlasUV = fragData.tangent.xy + fract(fragData.texCoords) * TILE_SIZE;
+    vec3 color = textureGrad(colorTex[fragData.textureID], atlasUV,
+                             dFdx(fragData.texCoords) * TILE_SIZE, dFdy(fragData.texCoords) * TILE_SIZE).rgb;
+    albedo = vec4(color, WATER_ALPHA);
+
+    normal = vec4(normalize(fragData.normal), fragData.ao);
+    position = fragData.worldPosition;
+}
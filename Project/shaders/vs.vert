@@ -26,8 +26,9 @@ layout (location = 0) out FragData{
     vec3 worldPosition;
     vec2 texCoords;
     vec3 normal;
-    vec3 tangent; // Unused
+    vec3 tangent; // xy = atlas origin of the face's tile
     flat uint textureID;
+    float ao; // Only chunk meshes bake occlusion
 } fragData;
 
 void main(){
@@ -37,7 +38,8 @@ void main(){
 
     fragData.texCoords = uv;
     fragData.normal = mat3(modelMatrix) * normal;
-    fragData.tangent = mat3(modelMatrix) * tangent;
+    fragData.tangent = tangent; // Atlas tile origin, not a direction
     fragData.textureID = materialIDs.at[gl_InstanceIndex];
+    fragData.ao = 1.0;
     gl_Position = camera.projection * camera.view * wPos;
 }
\ No newline at end of file
@@ -1 +1,60 @@
 #include "chunk.hpp"
+
+SectionConnectivity Chunk::computeConnectivity(int s) const {
+    constexpr int WORDS = SECTION_VOLUME / 64;
+    constexpr int LAYER = CHUNK_SIZE * CHUNK_SIZE; // Index step along y
+    const int base = s * SECTION_VOLUME;
+
+    // Leaves are opaque for face culling but can be seen through
+    const bool mayHaveLeaves = sections[s].mayContain(6);
+    bool anyOpaque = false;
+    bool allOpaque = true;
+    for (int w = base / 64; w < base / 64 + WORDS; ++w) {
+        anyOpaque |= opaqueBits[w] != 0;
+        allOpaque &= opaqueBits[w] == ~uint64_t(0);
+    }
+    if (!anyOpaque) return SectionConnectivity::all();
+    if (allOpaque && !mayHaveLeaves) return {};
+
+    auto passable = [&](int i) {
+        return !testBit(opaqueBits, base + i) || (mayHaveLeaves && sections[s].get(i) == 6);
+    };
+
+    SectionConnectivity result;
+    std::array<uint64_t, WORDS> seen{};
+    std::array<uint16_t, SECTION_VOLUME> stack;
+    for (int start = 0; start < SECTION_VOLUME; ++start) {
+        if ((seen[start >> 6] >> (start & 63)) & 1u || !passable(start)) continue;
+
+        // Collect the faces this region touches
+        uint8_t faces = 0;
+        int top = 0;
+        stack[top++] = static_cast<uint16_t>(start);
+        seen[start >> 6] |= uint64_t(1) << (start & 63);
+        while (top > 0) {
+            int i = stack[--top];
+            int x = i & CHUNK_MASK;
+            int z = (i / CHUNK_SIZE) & CHUNK_MASK;
+            int y = i / LAYER;
+            faces |= (x == CHUNK_SIZE - 1) << 0 | (x == 0) << 1 | (y == SECTION_HEIGHT - 1) << 2 |
+                     (y == 0) << 3 | (z == CHUNK_SIZE - 1) << 4 | (z == 0) << 5;
+
+            auto visit = [&](bool inside, int next) {
+                if (!inside || (seen[next >> 6] >> (next & 63)) & 1u || !passable(next)) return;
+                seen[next >> 6] |= uint64_t(1) << (next & 63);
+                stack[top++] = static_cast<uint16_t>(next);
+            };
+            visit(x < CHUNK_SIZE - 1, i + 1);
+            visit(x > 0, i - 1);
+            visit(y < SECTION_HEIGHT - 1, i + LAYER);
+            visit(y > 0, i - LAYER);
+            visit(z < CHUNK_SIZE - 1, i + CHUNK_SIZE);
+            visit(z > 0, i - CHUNK_SIZE);
+        }
+
+        for (int face = 0; face < 6; ++face) {
+            if (faces & (1u << face)) result.reachable[face] |= faces;
+        }
+    }
+    return result;
+}
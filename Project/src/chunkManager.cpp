@@ -3,23 +3,50 @@
 void ChunkManager::generateWorld(int width, int depth, PerlinNoise& perlin) {
     for (int chunkX = -width / 2; chunkX <= width / 2; ++chunkX) {
         for (int chunkZ = -depth / 2; chunkZ <= depth / 2; ++chunkZ) {
-            Chunk chunk;
-            chunk.key = {chunkX, chunkZ};
-            chunk.position = glm::vec3(chunkX * CHUNK_SIZE, 0, chunkZ * CHUNK_SIZE);
-            chunk.isGenerated = false;
-            chunk.isDirty = false;
+            // Generate terrain directly into pooled storage
+            Chunk* chunk = createChunk({chunkX, chunkZ});
+            TerrainManager::generateTerrain(*chunk, chunkX, chunkZ, perlin);
+        }
+    }
+}
 
-            // Generate terrain for the chunk
-            TerrainManager::generateTerrain(chunk, chunkX, chunkZ, perlin);
+Chunk* ChunkManager::createChunk(ChunkKey key) {
+    Chunk*& slot = chunks[key];
+    if (slot) {
+        gridErase(key);
+        chunkPool.release(slot);
+    }
+    slot = chunkPool.acquire();
+    slot->key = key;
+    slot->position = glm::vec3(key.x * CHUNK_SIZE, 0, key.z * CHUNK_SIZE);
+    gridInsert(slot);
+    dirtyChunks.insert(key); // The pool may hand back the address of the chunk it replaced
+    staleVisibility.insert(key);
+    return slot;
+}
 
-            // Store the chunk
-            chunks[{chunkX, chunkZ}] = std::move(chunk);
-        }
+void ChunkManager::resizeChunkGrid(int viewDistance) {
+    int shift = 4;
+    while ((1 << shift) < 2 * viewDistance + 1) ++shift;
+    if (shift == gridShift) return;
+
+    gridShift = shift;
+    gridMask = (1 << shift) - 1;
+    chunkGrid.assign(size_t(1) << (2 * shift), ChunkSlot{});
+    for (auto& [key, chunk] : chunks) {
+        gridInsert(chunk);
     }
 }
 
-void ChunkManager::addChunk(ChunkKey key, Chunk chunk) {
-    chunks[key] = std::move(chunk);
+void ChunkManager::gridInsert(Chunk* chunk) {
+    chunkGrid[((chunk->key.z & gridMask) << gridShift) | (chunk->key.x & gridMask)] = {chunk->key, chunk};
+}
+
+void ChunkManager::gridErase(const ChunkKey& key) {
+    ChunkSlot& slot = chunkGrid[((key.z & gridMask) << gridShift) | (key.x & gridMask)];
+    if (slot.chunk && slot.key == key) {
+        slot = ChunkSlot{};
+    }
 }
 
 void ChunkManager::updateTNT(){
@@ -48,8 +75,7 @@ void ChunkManager::updateTNT(){
                                 if (localPos.z < 0) localPos.z += CHUNK_SIZE;
 
                                 // Check if the block exists and is not air
-                                Voxel& block = chunk->voxels[localPos.x][localPos.y][localPos.z];
-                                if (block.type != 0) { // Skip air blocks
+                                if (chunk->getType(localPos.x, localPos.y, localPos.z) != 0) { // Skip air blocks
                                     mineBlock(targetPos); // Set to air
                                 }
                             }
@@ -70,72 +96,67 @@ void ChunkManager::updateTNT(){
 }
 
 void ChunkManager::clear() {
+    for (auto& [key, chunk] : chunks) chunkPool.release(chunk);
+    for (auto& [key, chunk] : savedChunks) chunkPool.release(chunk);
     chunks.clear();
     savedChunks.clear();
+    std::fill(chunkGrid.begin(), chunkGrid.end(), ChunkSlot{});
     combinedChunk.clear();
     dirtyChunks.clear();
+    changedVoxels.clear();
+    staleVisibility.clear();
+    waterFrontier.clear();
 }
 
 auto mod = [](int value, int mod) -> int {
     return (value % mod + mod) % mod;
 };
 
-void ChunkManager::updateVoxelsAroundPlayer(const glm::vec3& playerPosition, int radius) {
-    glm::ivec3 playerBlockPos = glm::floor(playerPosition);
-    
-    // Calculate the bounding box for the update radius
-    int startX = playerBlockPos.x - radius;
-    int endX = playerBlockPos.x + radius;
-    int startY = std::max(playerBlockPos.y - radius, 0); // Ensure y is within valid range
-    int endY = std::min(playerBlockPos.y + radius, CHUNK_SIZE_Y - 1);
-    int startZ = playerBlockPos.z - radius;
-    int endZ = playerBlockPos.z + radius;
+VisibilityMasks::Neighbours ChunkManager::getNeighbours(const Chunk& chunk) const {
+    return {
+        getChunk(chunk.key.x + 1, chunk.key.z),
+        getChunk(chunk.key.x - 1, chunk.key.z),
+        getChunk(chunk.key.x, chunk.key.z + 1),
+        getChunk(chunk.key.x, chunk.key.z - 1),
+    };
+}
 
-    // Iterate through the voxels within the radius
-    for (int x = startX; x <= endX; ++x) {
-        for (int y = startY; y <= endY; ++y) {
-            for (int z = startZ; z <= endZ; ++z) {
-                glm::ivec3 worldPos = {x, y, z};
-                
-                // Get the chunk and local coordinates for the voxel
-                Chunk* chunk = getChunkAt(worldPos);
-                //if (!chunk) continue;
-
-                glm::ivec3 localPos = {
-                    mod(x, CHUNK_SIZE),
-                    y,
-                    mod(z, CHUNK_SIZE)
-                };
-
-                Voxel& voxel = chunk->voxels[localPos.x][localPos.y][localPos.z];
-                if(voxel.type != 9){
-                // Perform visibility or type updates as needed
-                updateVoxelVisibility(voxel, *chunk, localPos);
-                }
+void ChunkManager::updateChunkVisibility(Chunk& chunk) {
+    VisibilityMasks::update(chunk, getNeighbours(chunk));
+}
+
+void ChunkManager::voxelChanged(const Chunk& chunk, const glm::ivec3& localPos) {
+    changedVoxels.insert(glm::ivec3(chunk.key.x << CHUNK_SHIFT, 0, chunk.key.z << CHUNK_SHIFT) + localPos);
+}
+
+void ChunkManager::updateChangedVoxels() {
+    // New chunks get a whole-chunk pass, and so do their neighbours whose borders now face them
+    static const int chunkOffsets[5][2] = {{0, 0}, {1, 0}, {-1, 0}, {0, 1}, {0, -1}};
+    std::unordered_set<ChunkKey, ChunkKeyHasher> refreshed;
+    for (const ChunkKey& key : staleVisibility) {
+        for (const auto& offset : chunkOffsets) {
+            Chunk* chunk = getChunk(key.x + offset[0], key.z + offset[1]);
+            if (chunk && refreshed.insert(chunk->key).second) {
+                updateChunkVisibility(*chunk);
             }
         }
     }
-}
+    staleVisibility.clear();
 
-void ChunkManager::updateWaterVoxels() {
-    // Iterate through all loaded chunks
-    for (auto& [chunkPos, chunk] : chunks) { // Assuming chunks is a map with chunk position as the key
-        // Iterate through all voxels in the chunk
-        for (int x = 0; x < CHUNK_SIZE; ++x) {
-            for (int y = 0; y < CHUNK_SIZE_Y; ++y) {
-                for (int z = 0; z < CHUNK_SIZE; ++z) {
-                    // Access the voxel
-                    Voxel& voxel = chunk.voxels[x][y][z];
-
-                    // Check if the voxel is a water voxel (e.g., type == 9)
-                    if (voxel.type == 9) {
-                        // Perform updates (e.g., visibility updates)
-                        updateVoxelVisibility(voxel, chunk, glm::ivec3{x, y, z});
-                    }
-                }
-            }
+    // An edit can only change the visibility of the edited voxel and its six neighbours
+    static const glm::ivec3 cellOffsets[] = {
+        {0, 0, 0}, {1, 0, 0}, {-1, 0, 0}, {0, 1, 0}, {0, -1, 0}, {0, 0, 1}, {0, 0, -1}
+    };
+    for (const glm::ivec3& cell : changedVoxels) {
+        for (const glm::ivec3& offset : cellOffsets) {
+            glm::ivec3 pos = cell + offset;
+            if (pos.y < 0 || pos.y >= CHUNK_SIZE_Y) continue;
+            Chunk* chunk = getChunk(pos.x >> CHUNK_SHIFT, pos.z >> CHUNK_SHIFT);
+            if (!chunk || refreshed.count(chunk->key)) continue;
+            updateVoxelVisibility(*chunk, {pos.x & CHUNK_MASK, pos.y, pos.z & CHUNK_MASK});
         }
     }
+    changedVoxels.clear();
 }
 
 void ChunkManager::updateCombinedChunk(const glm::vec3& playerPosition, int radius) {
@@ -148,20 +169,15 @@ void ChunkManager::updateCombinedChunk(const glm::vec3& playerPosition, int radi
     int endZ = playerBlockPos.z + radius;
 
     for (int x = startX; x <= endX; ++x) {
-        for (int y = startY; y <= endY; ++y) {
-            for (int z = startZ; z <= endZ; ++z) {
+        for (int z = startZ; z <= endZ; ++z) {
+            Chunk* chunk = getChunk(x >> CHUNK_SHIFT, z >> CHUNK_SHIFT);
+            if (!chunk) continue;
+
+            for (int y = startY; y <= endY; ++y) {
                 glm::ivec3 worldPos = {x, y, z};
-                Chunk* chunk = getChunkAt(worldPos);
-                if (!chunk) continue;
-
-                glm::ivec3 localPos = {
-                    mod(x, CHUNK_SIZE),
-                    y,
-                    mod(z, CHUNK_SIZE)
-                };
-                const Voxel& voxel = chunk->voxels[localPos.x][localPos.y][localPos.z];
-                if (voxel.visible) {
-                    combinedChunk[worldPos] = voxel;
+                glm::ivec3 localPos = {x & CHUNK_MASK, y, z & CHUNK_MASK};
+                if (chunk->isVisible(localPos.x, localPos.y, localPos.z)) {
+                    combinedChunk[worldPos] = chunk->getType(localPos.x, localPos.y, localPos.z);
                 } else {
                     combinedChunk.erase(worldPos); // Remove non-visible voxels
                 }
@@ -185,25 +201,21 @@ bool ChunkManager::hasExposedFace(Chunk& chunk, const glm::ivec3& localPos) {
                 if(neighborPos.y < 0){
                     continue;
                 }
-            glm::vec3 worldNeighborPos = worldPosition(chunk, neighborPos.x, neighborPos.y, neighborPos.z);
-            Chunk* neighborChunk = getChunkAt(worldNeighborPos);
+            Chunk* neighborChunk = getChunk(chunk.key.x + (neighborPos.x >> CHUNK_SHIFT),
+                                            chunk.key.z + (neighborPos.z >> CHUNK_SHIFT));
             if(!neighborChunk){
                 continue;
             }
             // Convert to local coordinates in the neighboring chunk
-            glm::ivec3 wrappedPos = {
-                mod(neighborPos.x, CHUNK_SIZE),
-                neighborPos.y,
-                mod(neighborPos.z, CHUNK_SIZE)
-            };
-            const Voxel& neighborVoxel = neighborChunk->voxels[wrappedPos.x][wrappedPos.y][wrappedPos.z];
-            if (neighborVoxel.type == 0 || neighborVoxel.type == 9) {
+            glm::ivec3 wrappedPos = {neighborPos.x & CHUNK_MASK, neighborPos.y, neighborPos.z & CHUNK_MASK};
+            int neighborType = neighborChunk->getVoxelType(wrappedPos.x, wrappedPos.y, wrappedPos.z);
+            if (neighborType == 0 || neighborType == 9) {
                 return true; // Exposed to air or fluid
             }
         } else {
             // Neighbor within the same chunk
-            const Voxel& neighborVoxel = chunk.voxels[neighborPos.x][neighborPos.y][neighborPos.z];
-            if (neighborVoxel.type == 0 || neighborVoxel.type == 9) {
+            int neighborType = chunk.getType(neighborPos.x, neighborPos.y, neighborPos.z);
+            if (neighborType == 0 || neighborType == 9) {
                 return true; // Exposed to air or fluid
             }
         }
@@ -212,21 +224,23 @@ bool ChunkManager::hasExposedFace(Chunk& chunk, const glm::ivec3& localPos) {
     return false; // Fully enclosed
 }
 
-void ChunkManager::updateVoxelVisibility(Voxel& voxel, Chunk& chunk, const glm::ivec3& localPos) {
+void ChunkManager::updateVoxelVisibility(Chunk& chunk, const glm::ivec3& localPos) {
+    int type = chunk.getType(localPos.x, localPos.y, localPos.z);
+
     // If the block is air, it's not visible
-    if (voxel.type == 0) {
-        voxel.visible = false;
+    if (type == 0) {
+        chunk.setVisible(localPos.x, localPos.y, localPos.z, false);
         return;
     }
 
-    if (voxel.type == 4 || voxel.type == 14) {
-        voxel.visible = true;
+    if (type == 4 || type == 14) {
+        chunk.setVisible(localPos.x, localPos.y, localPos.z, true);
         return;
     }
 
     // For non-water blocks, visibility depends on exposed faces
-    if (voxel.type != 9) {
-        voxel.visible = hasExposedFace(chunk, localPos);
+    if (type != 9) {
+        chunk.setVisible(localPos.x, localPos.y, localPos.z, hasExposedFace(chunk, localPos));
         return;
     }
 
@@ -235,6 +249,7 @@ void ChunkManager::updateVoxelVisibility(Voxel& voxel, Chunk& chunk, const glm::
         {1, 0, 0}, {-1, 0, 0}, {0, 1, 0}, {0, -1, 0}, {0, 0, 1}, {0, 0, -1}
     };
 
+    VoxelMeta meta = chunk.getMeta(localPos.x, localPos.y, localPos.z);
     for (int i = 0; i < 6; ++i) {
         glm::ivec3 neighborPos = localPos + directions[i];
         bool isFaceVisible = false;
@@ -245,25 +260,21 @@ void ChunkManager::updateVoxelVisibility(Voxel& voxel, Chunk& chunk, const glm::
             if(neighborPos.y < 0){
                 continue;
             }
-            Chunk* neighborChunk = getChunkAt(worldPosition(chunk, neighborPos.x, neighborPos.y, neighborPos.z));
+            Chunk* neighborChunk = getChunk(chunk.key.x + (neighborPos.x >> CHUNK_SHIFT),
+                                            chunk.key.z + (neighborPos.z >> CHUNK_SHIFT));
             if(!neighborChunk){
                 continue;
             }
-            glm::ivec3 wrappedPos = {
-                mod(neighborPos.x, CHUNK_SIZE),
-                neighborPos.y,
-                mod(neighborPos.z, CHUNK_SIZE)
-            };
-            const Voxel& neighborVoxel = neighborChunk->voxels[wrappedPos.x][wrappedPos.y][wrappedPos.z];
-            isFaceVisible = (neighborVoxel.type == 0); // Exposed to air
+            glm::ivec3 wrappedPos = {neighborPos.x & CHUNK_MASK, neighborPos.y, neighborPos.z & CHUNK_MASK};
+            isFaceVisible = (neighborChunk->getVoxelType(wrappedPos.x, wrappedPos.y, wrappedPos.z) == 0); // Exposed to air
         } else {
             // Neighbor within the same chunk
-            const Voxel& neighborVoxel = chunk.voxels[neighborPos.x][neighborPos.y][neighborPos.z];
-            isFaceVisible = (neighborVoxel.type == 0); // Exposed to air
+            isFaceVisible = (chunk.getType(neighborPos.x, neighborPos.y, neighborPos.z) == 0); // Exposed to air
         }
-        voxel.faceVisible[i] = isFaceVisible;
+        meta.faceMask = isFaceVisible ? (meta.faceMask | (1u << i)) : (meta.faceMask & ~(1u << i));
     }
-    voxel.visible = true; // Water always active for world actions
+    chunk.setMeta(localPos.x, localPos.y, localPos.z, meta);
+    chunk.setVisible(localPos.x, localPos.y, localPos.z, true); // Water always active for world actions
 }
 
 void ChunkManager::updateChunks(const glm::mat4& viewProjectionMatrix, const glm::vec3& playerPosition, int viewDistance) {
@@ -274,6 +285,7 @@ void ChunkManager::updateChunks(const glm::mat4& viewProjectionMatrix, const glm
         updated = false;
     }
     incrementTick();
+    resizeChunkGrid(viewDistance);
 
     std::unordered_set<ChunkKey, ChunkKeyHasher> requiredChunks;
 
@@ -287,7 +299,8 @@ void ChunkManager::updateChunks(const glm::mat4& viewProjectionMatrix, const glm
     // Unload chunks not in view and save them
     for (auto it = chunks.begin(); it != chunks.end();) {
         if (requiredChunks.find(it->first) == requiredChunks.end()) {
-            savedChunks[it->first] = std::move(it->second); // Save chunk before unloading
+            gridErase(it->first);
+            savedChunks[it->first] = it->second; // Save chunk before unloading
             it = chunks.erase(it); // Unload chunk
             updated = true;
         } else {
@@ -299,93 +312,93 @@ void ChunkManager::updateChunks(const glm::mat4& viewProjectionMatrix, const glm
     for (const auto& key : requiredChunks) {
         if (chunks.find(key) == chunks.end()) {
             // Load from savedChunks if available
-            if (savedChunks.find(key) != savedChunks.end()) {
-                chunks[key] = std::move(savedChunks[key]);
-                chunks[key].isDirty = true;
-                savedChunks.erase(key);
-            } 
+            auto saved = savedChunks.find(key);
+            if (saved != savedChunks.end()) {
+                chunks[key] = saved->second;
+                chunks[key]->isDirty = true;
+                staleVisibility.insert(key); // Its borders were last computed against other neighbours
+                savedChunks.erase(saved);
+            } else {
+                createChunk(key); // Outside the generated world: empty air chunk
+            }
         }
+        gridInsert(chunks[key]); // Required chunks always own their grid slot
     }
     
     // Simulate water in the visible range
     for (const auto& key : requiredChunks) {
-    auto& chunk = chunks[key];
-        for (int x = 0; x < CHUNK_SIZE; ++x) {
-            for (int y = 0; y < CHUNK_SIZE_Y; ++y) {
-                for (int z = 0; z < CHUNK_SIZE; ++z) {
-                    if (chunk.voxels[x][y][z].type == 8 && y > 1 && (chunk.voxels[x][y-1][z].type == 0 || chunk.voxels[x][y-1][z].type == 9)) {
+    auto& chunk = *chunks[key];
+        for (int y = 0; y < CHUNK_SIZE_Y; ++y) {
+            if (!chunk.section(y / SECTION_HEIGHT).mayContain(8)) { // No sand in this section
+                y += SECTION_HEIGHT - 1 - y % SECTION_HEIGHT;
+                continue;
+            }
+            for (int z = 0; z < CHUNK_SIZE; ++z) {
+                for (int x = 0; x < CHUNK_SIZE; ++x) {
+                    if (chunk.getType(x, y, z) == 8 && y > 1 && (chunk.getType(x, y-1, z) == 0 || chunk.getType(x, y-1, z) == 9)) {
                         simulateSand(chunk, x, y, z);
                         }
                     }
                 }
             }
         }
-    if(currentTick >= 90){
-        if (!generateWaterQueue.empty()) {
-            simulateWater(generateWaterQueue);
-            currentTick = 0;
+    // Water steps at a fixed wall-clock rate, independent of the frame rate
+    auto now = std::chrono::steady_clock::now();
+    if (std::chrono::duration<float>(now - lastWaterTick).count() >= waterTickSeconds) {
+        lastWaterTick = now;
+        if (!waterFrontier.empty()) {
+            simulateWater(waterCellsPerTick);
         }
         if (!removeWaterQueue.empty()) {
             removeWater();
-            currentTick = 0;
         }
     }
     updateTNT();
-    updateVoxelsAroundPlayer(playerPosition, 8); // Update voxels in a 6-block radius
-    updateWaterVoxels();
+    updateChangedVoxels();
     updateCombinedChunk(playerPosition, 3);
 
     // Combine chunks if the current player's chunk is dirty
     for(const auto& key : requiredChunks){
-    if (chunks[key].isDirty) {
-        chunks[key].isDirty = false;
+    if (chunks[key]->isDirty) {
+        chunks[key]->isDirty = false;
+        dirtyChunks.insert(key); // Picked up by the mesh cache
         updated = true;
         }
     }
 }
 
 bool ChunkManager::isPositionUnderwater(const glm::vec3& position) const {
-    if(getBlockAt(position)){
-    return (getBlockAt(position)->type == 9); // Assuming 9 is the water block type
-    } else return false;
+    return getBlockTypeAt(position) == 9; // Assuming 9 is the water block type
 }
 
-void ChunkManager::simulateWater(std::unordered_map<glm::vec3, std::pair<int, int>>& queue) {
-    std::unordered_map<glm::vec3, std::pair<int, int>> newQueue; // Store new positions for the next simulation step
-
-    for (auto& [pos, data] : queue) {
-        int sourceID = data.first;
-        int travelDistance = data.second;
-
+void ChunkManager::simulateWater(size_t budget) {
+    // Cells reached in this step join the back of the frontier and flow in a later one
+    waterFrontier.process(budget, [&](const glm::ivec3& cell, int sourceID, int travelDistance) {
+        glm::vec3 pos(cell);
         Chunk* chunk = getChunkAt(pos);
         if (!chunk) {
-            continue; // Skip if chunk is not loaded
+            return; // Skip if chunk is not loaded
         }
 
-        int localX = mod(static_cast<int>(pos.x), CHUNK_SIZE);
-        int localY = static_cast<int>(pos.y);
-        int localZ = mod(static_cast<int>(pos.z), CHUNK_SIZE);
-
-        Voxel& voxel = chunk->voxels[localX][localY][localZ];
-
         // Check downward flow
         glm::vec3 belowPos = pos + glm::vec3(0, -1, 0);
-        Voxel* below = getBlockAt(belowPos);
+        VoxelRef below = getBlockAt(belowPos);
         // Stop spreading if it reaches other water
-        if (below && below->type == 9 && travelDistance > 0) {
-            continue; // Terminate this water flow
+        if (below && below.type() == 9 && travelDistance > 0) {
+            return; // Terminate this water flow
         }
-        if (below && below->type == 0) { // Check if below is air
-            below->type = 9; // Flowing water
-            below->sourceID = sourceID;
-            below->updated = true;
+        if (below && below.type() == 0) { // Check if below is air
+            below.setType(9); // Flowing water
+            below.setMeta({.isSource = false, .sourceID = sourceID});
+            below.markUpdated();
+            voxelChanged(*below.chunk, below.local);
 
             // Update waterBlocksByID
             waterBlocksByID[sourceID].push_back(belowPos);
 
             chunk->isDirty = true;
-            newQueue[belowPos] = {sourceID, 0}; // Reset travel distance for downward flow
-            continue; // Skip further checks for this element
+            waterFrontier.push(cell + glm::ivec3(0, -1, 0), sourceID, 0); // Reset travel distance for downward flow
+            return; // Skip further checks for this element
         }
 
         // Check sideways flow (only if downward is not possible)
@@ -395,27 +408,26 @@ void ChunkManager::simulateWater(std::unordered_map<glm::vec3, std::pair<int, in
 
             for (const auto& dir : directions) {
                 glm::vec3 neighborPos = pos + glm::vec3(dir);
-                Voxel* neighbor = getBlockAt(neighborPos);
+                VoxelRef neighbor = getBlockAt(neighborPos);
 
                 // Check if neighbor is air and either unassigned (-1) or matches the current source
-                if (neighbor && neighbor->type == 0) { // Spread only to air blocks
-                    neighbor->type = 9; // Flowing water
-                    if (neighbor->sourceID == -1 || neighbor->sourceID == sourceID) { // Assign sourceID only if it matches or is unassigned
-                        neighbor->sourceID = sourceID;
+                if (neighbor && neighbor.type() == 0) { // Spread only to air blocks
+                    neighbor.setType(9); // Flowing water
+                    neighbor.setSource(false);
+                    voxelChanged(*neighbor.chunk, neighbor.local);
+                    if (neighbor.sourceID() == -1 || neighbor.sourceID() == sourceID) { // Assign sourceID only if it matches or is unassigned
+                        neighbor.setSourceID(sourceID);
 
                         // Update waterBlocksByID
                         waterBlocksByID[sourceID].push_back(neighborPos);
 
                         chunk->isDirty = true;
-                        newQueue[neighborPos] = {sourceID, travelDistance + 1};
+                        waterFrontier.push(cell + dir, sourceID, travelDistance + 1);
                     }
                 }
             }
         }
-    }
-
-    // Replace the current queue with the new queue for the next tick
-    queue = std::move(newQueue);
+    });
 }
 
 void ChunkManager::removeWater() {
@@ -447,11 +459,10 @@ void ChunkManager::removeWater() {
                     int localY = static_cast<int>(pos.y);
                     int localZ = mod(static_cast<int>(pos.z), CHUNK_SIZE);
 
-                    Voxel& voxel = chunk->voxels[localX][localY][localZ];
-                    if (voxel.type == 9 && voxel.sourceID == sourceID) {
-                        voxel.type = 0; // Remove the water block
-                        voxel.sourceID = -1; // Reset sourceID
-                        voxel.updated = true;
+                    if (chunk->getType(localX, localY, localZ) == 9 && chunk->getMeta(localX, localY, localZ).sourceID == sourceID) {
+                        chunk->setType(localX, localY, localZ, 0); // Remove the water block, resetting sourceID
+                        chunk->setUpdated(localX, localY, localZ, true);
+                        voxelChanged(*chunk, {localX, localY, localZ});
                         chunk->isDirty = true; // Mark chunk as dirty
                         removedAny = true;
                     }
@@ -475,74 +486,45 @@ void ChunkManager::removeWater() {
 }
 
 const Chunk* ChunkManager::getChunkAt(const glm::vec3& position) const {
-    int chunkX = static_cast<int>(floor(position.x / CHUNK_SIZE));
-    int chunkZ = static_cast<int>(floor(position.z / CHUNK_SIZE));
-
-    ChunkKey key{chunkX, chunkZ};
-    auto it = chunks.find(key);
-    if (it != chunks.end()) {
-        return &it->second; // Return const pointer
-    }
-    return nullptr;
+    return getChunk(static_cast<int>(std::floor(position.x)) >> CHUNK_SHIFT,
+                    static_cast<int>(std::floor(position.z)) >> CHUNK_SHIFT);
 }
 
 Chunk* ChunkManager::getChunkAt(const glm::vec3& position) {
-    int chunkX = static_cast<int>(floor(position.x / CHUNK_SIZE));
-    int chunkZ = static_cast<int>(floor(position.z / CHUNK_SIZE));
-
-    ChunkKey key{chunkX, chunkZ};
-    auto it = chunks.find(key);
-    if (it != chunks.end()) {
-        return &it->second; // Return non-const pointer
-    }
-    return nullptr;
+    return getChunk(static_cast<int>(std::floor(position.x)) >> CHUNK_SHIFT,
+                    static_cast<int>(std::floor(position.z)) >> CHUNK_SHIFT);
 }
 
-const Voxel* ChunkManager::getBlockAt(const glm::vec3& position) const {
-    const Chunk* chunk = getChunkAt(position);
-    if (!chunk) return nullptr;
-
-    int localX = static_cast<int>(position.x) % CHUNK_SIZE;
+int ChunkManager::getBlockTypeAt(const glm::vec3& position) const {
+    int x = static_cast<int>(std::floor(position.x));
     int localY = static_cast<int>(position.y);
-    int localZ = static_cast<int>(position.z) % CHUNK_SIZE;
+    int z = static_cast<int>(std::floor(position.z));
 
-    if (localX < 0) localX += CHUNK_SIZE;
-    if (localZ < 0) localZ += CHUNK_SIZE;
+    const Chunk* chunk = getChunk(x >> CHUNK_SHIFT, z >> CHUNK_SHIFT);
+    if (!chunk) return -1;
 
     if (localY >= 0 && localY < CHUNK_SIZE_Y) {
-        return &chunk->voxels[localX][localY][localZ]; // Return const Voxel pointer
+        return chunk->getType(x & CHUNK_MASK, localY, z & CHUNK_MASK);
     }
-    return nullptr;
+    return -1;
 }
 
-Voxel* ChunkManager::getBlockAt(const glm::vec3& position) {
-    // Determine the chunk the position belongs to
-    int chunkX = static_cast<int>(std::floor(position.x / CHUNK_SIZE));
-    int chunkZ = static_cast<int>(std::floor(position.z / CHUNK_SIZE)); 
-
-    ChunkKey key{chunkX, chunkZ};
-    auto it = chunks.find(key);
-    if (it == chunks.end()) {
-        return nullptr; // Chunk is not loaded
-    }
-
-    Chunk* chunk = &it->second;
-
-    // Determine the block's local coordinates within the chunk
-    int localX = static_cast<int>(std::floor(position.x)) % CHUNK_SIZE;
+VoxelRef ChunkManager::getBlockAt(const glm::vec3& position) {
+    int x = static_cast<int>(std::floor(position.x));
     int localY = static_cast<int>(position.y);
-    int localZ = static_cast<int>(std::floor(position.z)) % CHUNK_SIZE;
+    int z = static_cast<int>(std::floor(position.z));
 
-    // Handle negative indices for wrapping
-    if (localX < 0) localX += CHUNK_SIZE;
-    if (localZ < 0) localZ += CHUNK_SIZE;
+    Chunk* chunk = getChunk(x >> CHUNK_SHIFT, z >> CHUNK_SHIFT);
+    if (!chunk) {
+        return {}; // Chunk is not loaded
+    }
 
     // Ensure the local position is valid
     if (localY >= 0 && localY < CHUNK_SIZE_Y) {
-        return &chunk->voxels[localX][localY][localZ];
+        return {chunk, {x & CHUNK_MASK, localY, z & CHUNK_MASK}};
     }
 
-    return nullptr; // Invalid block position
+    return {}; // Invalid block position
 }
 
 std::optional<glm::vec3> ChunkManager::getPlacementPosition(
@@ -630,40 +612,41 @@ std::optional<glm::vec3> ChunkManager::getNormal(
 }
 
 void ChunkManager::simulateSand(Chunk& chunk, int x, int y, int z) {
-    Voxel& voxel = chunk.voxels[x][y][z];
-
     // Skip if not a sand block
-    if (voxel.type != 8) {
+    if (chunk.getType(x, y, z) != 8) {
         return;
     }
 
     // Tick interval for sand
     int tickInterval = 10;
-    if (currentTick - voxel.tickCounter < tickInterval) {
+    VoxelMeta meta = chunk.getMeta(x, y, z);
+    if (currentTick - meta.tickCounter < tickInterval) {
         return;
     }
-    voxel.tickCounter = currentTick;
-    Voxel& below = chunk.voxels[x][y - 1][z];
-    if (below.type != 0 && below.type != 9) {
+    meta.tickCounter = currentTick;
+    chunk.setMeta(x, y, z, meta);
+    int belowType = chunk.getType(x, y - 1, z);
+    if (belowType != 0 && belowType != 9) {
         return;
     }
     // Check the block below
     if (y > 0) { // Ensure not at the bottom of the chunk
         //std::cout << "found either water or air under the sand block\n";
+        VoxelMeta belowMeta = chunk.getMeta(x, y - 1, z);
 
-        if(below.type == 9 && below.isSource){
-            std::cout << "Sand found water source with ID: " << below.sourceID << "\n";
-            addToRemoveQueue(below.sourceID, glm::vec3(x, y-1,z));;
-            below.sourceID = -1;
+        if(belowType == 9 && belowMeta.isSource){
+            std::cout << "Sand found water source with ID: " << belowMeta.sourceID << "\n";
+            addToRemoveQueue(belowMeta.sourceID, glm::vec3(x, y-1,z));;
+            belowMeta.sourceID = -1;
+            chunk.setMeta(x, y - 1, z, belowMeta);
         } 
 
-        voxel.updated = true;
-        voxel.type = 0;
-        voxel.visible = false;
+        chunk.setUpdated(x, y, z, true);
+        chunk.setType(x, y, z, 0); // Also resets sourceID and isSource
+        chunk.setVisible(x, y, z, false);
+        voxelChanged(chunk, {x, y, z});
         chunk.isDirty = true;
-        voxel.sourceID = -1;
-        voxel.isSource = false;
-        if(below.type == 9 && below.isSource && below.sourceID == -1){
+        if(belowType == 9 && belowMeta.isSource && belowMeta.sourceID == -1){
             bool found = false;
             glm::vec3 worldPos = worldPosition(chunk, x, y, z);
             for (int dx = -1; dx <= 1; ++dx) {
@@ -672,15 +655,13 @@ void ChunkManager::simulateSand(Chunk& chunk, int x, int y, int z) {
                             if(found) continue;
                             if (abs(dx) + abs(dz) != 1) continue; // Only direct neighbors
                             glm::vec3 neighborPos = worldPos + glm::vec3(dx, 0, dz);
-                            Voxel* neighbor = getBlockAt(neighborPos);
-                            //std::cout << "Checking pos: " << glm::to_string(neighborPos) << ", Block is: " << neighbor->type << ", source is: " << neighbor->isSource << "\n";
-                            if (neighbor && (neighbor->type == 9 && neighbor->isSource)) {
-                                neighbor->sourceID = -1;
-                                voxel.type = 9;
-                                voxel.isSource = true;
-                                voxel.sourceID = -1;
-                                voxel.visible = true;
-                                //std::cout << "Found neighboring water with source ID: " << neighbor->sourceID << "\n";
+                            VoxelRef neighbor = getBlockAt(neighborPos);
+                            //std::cout << "Checking pos: " << glm::to_string(neighborPos) << ", Block is: " << neighbor.type() << ", source is: " << neighbor.isSource() << "\n";
+                            if (neighbor && (neighbor.type() == 9 && neighbor.isSource())) {
+                                neighbor.setSourceID(-1);
+                                chunk.setType(x, y, z, 9); // Untracked water source
+                                chunk.setVisible(x, y, z, true);
+                                //std::cout << "Found neighboring water with source ID: " << neighbor.sourceID() << "\n";
                                 found = true;
                     }
                 }
@@ -692,10 +673,11 @@ void ChunkManager::simulateSand(Chunk& chunk, int x, int y, int z) {
         std::cout << "Changing value of sand\n";
     
         // Move the sand block down
-        below.type = 8;
-        below.updated = true;
-        below.visible = true;
-        below.tickCounter = currentTick; // Reset tick for the moved block
+        chunk.setType(x, y - 1, z, 8);
+        chunk.setUpdated(x, y - 1, z, true);
+        voxelChanged(chunk, {x, y - 1, z});
+        chunk.setVisible(x, y - 1, z, true);
+        chunk.setMeta(x, y - 1, z, {.tickCounter = currentTick}); // Reset tick for the moved block
         chunk.isDirty = true;
         simulateSand(chunk, x, y-1, z);
     }
@@ -718,30 +700,30 @@ bool ChunkManager::placeBlock(const glm::vec3& placementPosition, int newBlockTy
     }
 
     // Retrieve the block at the placement position
-    Voxel* block = getBlockAt(placementPosition);
-    if (block && (block->type == 0 || block->type == 9)) { // Ensure the block is empty (air or water)
+    VoxelRef block = getBlockAt(placementPosition);
+    if (block && (block.type() == 0 || block.type() == 9)) { // Ensure the block is empty (air or water)
         Chunk* chunk = getChunkAt(placementPosition);
 
-        if(block->type == 9 && block->type != newBlockType && block->isSource){
-            addToRemoveQueue(block->sourceID, placementPosition);
-            std::cout << "id: " << block->sourceID << " added to remove queue\n";
-            block->sourceID = -1;
+        if(block.type() == 9 && block.type() != newBlockType && block.isSource()){
+            addToRemoveQueue(block.sourceID(), placementPosition);
+            std::cout << "id: " << block.sourceID() << " added to remove queue\n";
+            block.setSourceID(-1);
         }
 
-        block->type = newBlockType; // Place the new block
-        block->updated = true;
-        if (block->type == 9) { // Water block
-            block->isSource = true; // Mark as a source block
+        block.setType(newBlockType); // Place the new block
+        block.markUpdated();
+        voxelChanged(*block.chunk, block.local);
+        if (block.type() == 9) { // Water block
             int id = getLowestFreeID();
-            block->sourceID = id;
+            block.setMeta({.isSource = true, .sourceID = id}); // Mark as a source block
             onWaterSourceAdded(placementPosition, id);
-            std::cout << "id: " << block->sourceID << " added to generate queue\n";
+            std::cout << "id: " << block.sourceID() << " added to generate queue\n";
         }
 
         glm::ivec3 blockPos = glm::floor(placementPosition);
         auto it = combinedChunk.find(blockPos);
         if (it != combinedChunk.end()) {
-            combinedChunk[blockPos].type = newBlockType;
+            it->second = static_cast<BlockID>(newBlockType);
         }
 
         
@@ -751,7 +733,7 @@ bool ChunkManager::placeBlock(const glm::vec3& placementPosition, int newBlockTy
         }
 
         if (newBlockType == 8) { // Sand block
-            block->tickCounter = currentTick; // Delay the simulation for one tick interval
+            block.setMeta({.tickCounter = currentTick}); // Delay the simulation for one tick interval
         }
 
         //std::cout << "Block placed successfully at: " << glm::to_string(placementPosition) << "\n";
@@ -802,9 +784,9 @@ void ChunkManager::updateMinedBlocks(float deltaTime, const glm::vec3& playerPos
 
         // Check if there's ground beneath
         glm::ivec3 groundBlockPos = glm::floor(nextPos - glm::vec3(0.0f, blockRadius, 0.0f));
-        const Voxel* groundBlock = getBlockAt(groundBlockPos);
+        int groundType = getBlockTypeAt(groundBlockPos);
 
-        if (groundBlock && groundBlock->type != 0) {
+        if (groundType > 0) {
             // Stop falling if there's ground beneath
             if (it->velocity.y < 0.0f) {
                 it->velocity.y = -it->velocity.y * 0.5f; // Reverse and reduce vertical velocity for bouncing
@@ -835,8 +817,8 @@ void ChunkManager::updateMinedBlocks(float deltaTime, const glm::vec3& playerPos
 
         // Prevent movement into existing blocks
         glm::ivec3 nextBlockPos = glm::floor(nextPos);
-        const Voxel* nextBlock = getBlockAt(nextBlockPos);
-        if (nextBlock && nextBlock->type != 0) {
+        int nextType = getBlockTypeAt(nextBlockPos);
+        if (nextType > 0) {
             nextPos = it->pos; // Prevent position update
             it->velocity = glm::vec3(0.0f); // Stop the block's velocity
         }
@@ -884,12 +866,12 @@ void ChunkManager::updateMinedBlocks(float deltaTime, const glm::vec3& playerPos
 }
 
 bool ChunkManager::mineBlock(const glm::vec3& position) {
-    Voxel* block = getBlockAt(position);
-    if (block && block->type != 0 && block->type != 3 && block->type != 9) {
-        //std::cout << "Before Mining: Block Type = " << block->type << " at " << position.x << ", " << position.y << ", " << position.z << "\n";
+    VoxelRef block = getBlockAt(position);
+    if (block && block.type() != 0 && block.type() != 3 && block.type() != 9) {
+        //std::cout << "Before Mining: Block Type = " << block.type() << " at " << position.x << ", " << position.y << ", " << position.z << "\n";
         bool tnt = false;
         int lifeTime = 1000;
-        if (block->type == 11) {
+        if (block.type() == 11) {
             // Add TNT to activeTNT map
             glm::ivec3 blockPos = glm::floor(position);
             int tntID = static_cast<int>(activeTNT.size()); // Assign a unique ID based on current size
@@ -915,20 +897,19 @@ bool ChunkManager::mineBlock(const glm::vec3& position) {
             .pos = position + glm::vec3(0.0f, 1.0f, 0.0f), // Centered position
             .orientation = glm::vec3(0.0f),                 // Initial orientation
             .velocity = glm::vec3(randomVelocity(gen), 1.0f, randomVelocity(gen)), // Random x, z velocity
-            .type = block->type,                            // Type of the mined block
+            .type = block.type(),                           // Type of the mined block
             .lifetime = lifeTime,
             .tnt = tnt                                // Lifetime in ticks
         });
 
-        block->type = 0;
-        block->isSource = false;
-        block->sourceID = -1;
-        block->updated = true;
+        block.setType(0); // Also resets isSource and sourceID
+        block.markUpdated();
+        voxelChanged(*block.chunk, block.local);
 
         glm::ivec3 blockPos = glm::floor(position);
         auto it = combinedChunk.find(blockPos);
         if (it != combinedChunk.end()) {
-            combinedChunk[blockPos].type = 0;
+            it->second = 0;
         }
         
         Chunk* chunk = getChunkAt(position);
@@ -948,63 +929,173 @@ bool ChunkManager::mineBlock(const glm::vec3& position) {
                         if(found) continue;
                         if (abs(dx) + abs(dy) + abs(dz) != 1) continue; // Only direct neighbors
                         glm::vec3 neighborPos = position + glm::vec3(dx, dy, dz);
-                        Voxel* neighbor = getBlockAt(neighborPos);
-                        //std::cout << "Checking pos: " << glm::to_string(neighborPos) << ", Block is: " << neighbor->type << ", source is: " << neighbor->isSource << "\n";
-                        if (neighbor && (neighbor->type == 9 && neighbor->isSource)) {
-                            //std::cout << "Found neighboring water with source ID: " << neighbor->sourceID << "\n";
-                            handleWaterBlock(neighborPos, *neighbor);
+                        VoxelRef neighbor = getBlockAt(neighborPos);
+                        //std::cout << "Checking pos: " << glm::to_string(neighborPos) << ", Block is: " << neighbor.type() << ", source is: " << neighbor.isSource() << "\n";
+                        if (neighbor && (neighbor.type() == 9 && neighbor.isSource())) {
+                            //std::cout << "Found neighboring water with source ID: " << neighbor.sourceID() << "\n";
+                            handleWaterBlock(neighborPos, neighbor);
                         }
                     }
                 }
             }
             // Check for sand above the removed block
             if (blockPos.y + 1 < CHUNK_SIZE_Y) {
-                Voxel& above = chunk->voxels[blockPos.x][blockPos.y + 1][blockPos.z];
-                if (above.type && above.type == 8) { // Sand block
-                    simulateSand(*chunk, blockPos.x, blockPos.y + 1, blockPos.z);
+                if (chunk->getType(block.local.x, blockPos.y + 1, block.local.z) == 8) { // Sand block
+                    simulateSand(*chunk, block.local.x, blockPos.y + 1, block.local.z);
                 }
             }
         }
-        //std::cout << "After Mining: Block Type = " << block->type << " at " << position.x << ", " << position.y << ", " << position.z << "\n";
+        //std::cout << "After Mining: Block Type = " << block.type() << " at " << position.x << ", " << position.y << ", " << position.z << "\n";
         return true;
     }
     return false;
 }
 
-void ChunkManager::handleWaterBlock(const glm::vec3& position, Voxel& block) {
+void ChunkManager::handleWaterBlock(const glm::vec3& position, VoxelRef block) {
     // If the block is a source block
-    if (block.sourceID >= 0) {
-        onWaterSourceAdded(position, block.sourceID);
+    if (block.sourceID() >= 0) {
+        onWaterSourceAdded(position, block.sourceID());
     } else {
         // Assign a temporary ID for untracked source blocks
         int tempID = tempIDStart--;
-        block.sourceID = tempID;
-        generateWaterQueue[position] = {tempID, 0};
+        block.setSourceID(tempID);
+        waterFrontier.push(glm::ivec3(glm::floor(position)), tempID, 0);
     }
 }
 
 bool ChunkManager::isVoxelVisibleToPlayer(const Chunk& chunk, int x, int y, int z) const {
     // Check if the voxel is at the edge of the chunk or has air as a neighbor
-    if (chunk.voxels[x - 1][y][z].type == 0) return true; // Left neighbor
-    if (chunk.voxels[x + 1][y][z].type == 0) return true; // Right neighbor
-    if (chunk.voxels[x][y - 1][z].type == 0) return true; // Bottom neighbor
-    if (chunk.voxels[x][y + 1][z].type == 0) return true; // Top neighbor
-    if (chunk.voxels[x][y][z - 1].type == 0) return true; // Front neighbor
-    if (chunk.voxels[x][y][z + 1].type == 0) return true; // Back neighbor
+    if (chunk.getVoxelType(x - 1, y, z) == 0) return true; // Left neighbor
+    if (chunk.getVoxelType(x + 1, y, z) == 0) return true; // Right neighbor
+    if (chunk.getVoxelType(x, y - 1, z) == 0) return true; // Bottom neighbor
+    if (chunk.getVoxelType(x, y + 1, z) == 0) return true; // Top neighbor
+    if (chunk.getVoxelType(x, y, z - 1) == 0) return true; // Front neighbor
+    if (chunk.getVoxelType(x, y, z + 1) == 0) return true; // Back neighbor
     
 
     return false; // Not visible
 }
 
-std::vector<Chunk*> ChunkManager::getVisibleChunks(const glm::vec3& playerPosition, int viewDistance, const glm::mat4& viewProjectionMatrix) {
+std::vector<Chunk*> ChunkManager::getVisibleChunks(const glm::vec3& cameraPosition, int viewDistance, const glm::mat4& viewProjectionMatrix,
+                                                   SectionMasks& visibleSections) {
+    int cameraChunkX = static_cast<int>(std::floor(cameraPosition.x / CHUNK_SIZE));
+    int cameraChunkZ = static_cast<int>(std::floor(cameraPosition.z / CHUNK_SIZE));
+    const Frustum frustum = Frustum::fromMatrix(viewProjectionMatrix);
+
     std::vector<Chunk*> visibleChunks;
+    visibleChunks.reserve(chunks.size());
     for (auto& [key, chunk] : chunks) {
-            visibleChunks.push_back(&chunk);
-        
+        if (std::max(std::abs(key.x - cameraChunkX), std::abs(key.z - cameraChunkZ)) > viewDistance) continue;
+        visibleChunks.push_back(chunk);
+    }
+    cullToFrustum(visibleChunks, frustum, [](Chunk* chunk) { return chunk; });
+
+    // Drop chunks no section path from the camera can see into; sections below the
+    // surface, such as caves, are left out of the draws of the chunks that stay
+    visibleSections.clear();
+    if (traverseSections(cameraPosition, frustum, visibleSections)) {
+        std::erase_if(visibleChunks, [&](Chunk* chunk) { return !visibleSections.contains(chunk->key); });
     }
     return visibleChunks;
 }
 
+bool ChunkManager::traverseSections(const glm::vec3& cameraPosition, const Frustum& frustum, SectionMasks& reached) const {
+    static const int steps[6][3] = {{1, 0, 0}, {-1, 0, 0}, {0, 1, 0}, {0, -1, 0}, {0, 0, 1}, {0, 0, -1}};
+
+    struct Step {
+        const Chunk* chunk;
+        int section;
+        int entered;        // Face the walk came in through, -1 for the camera's section
+        uint8_t directions; // Faces stepped through so far; the walk never turns back against one
+    };
+
+    // Above or below the world, or in an unloaded chunk, there is no section to start from
+    glm::ivec3 cell = glm::floor(cameraPosition);
+    const Chunk* start = getChunk(cell.x >> CHUNK_SHIFT, cell.z >> CHUNK_SHIFT);
+    if (!start || cell.y < 0 || cell.y >= CHUNK_SIZE_Y) return false;
+
+    // Sections are marked when queued, and every queued section is entered
+    std::queue<Step> open;
+    open.push({start, cell.y / SECTION_HEIGHT, -1, 0});
+    reached[start->key] = uint8_t(1u << (cell.y / SECTION_HEIGHT));
+
+    while (!open.empty()) {
+        Step step = open.front();
+        open.pop();
+        const SectionConnectivity& connectivity = step.chunk->connectivity(step.section);
+
+        for (int face = 0; face < 6; ++face) {
+            if (step.directions & (1u << (face ^ 1))) continue; // Opposite faces differ in the lowest bit
+            if (step.entered >= 0 && !connectivity.connects(step.entered, face)) continue;
+
+            int section = step.section + steps[face][1];
+            if (section < 0 || section >= CHUNK_SECTIONS) continue;
+            const Chunk* next = step.chunk;
+            if (steps[face][0] != 0 || steps[face][2] != 0) {
+                next = getChunk(step.chunk->key.x + steps[face][0], step.chunk->key.z + steps[face][2]);
+                if (!next) continue;
+            }
+
+            auto found = reached.find(next->key);
+            if (found != reached.end() && (found->second & (1u << section))) continue;
+            glm::vec3 min = next->position + glm::vec3(0.0f, section * SECTION_HEIGHT, 0.0f) - glm::vec3(1.0f);
+            glm::vec3 max = next->position + glm::vec3(CHUNK_SIZE, (section + 1) * SECTION_HEIGHT, CHUNK_SIZE) + glm::vec3(1.0f);
+            if (!frustum.intersects(min, max)) continue;
+
+            reached[next->key] |= uint8_t(1u << section);
+            open.push({next, section, face ^ 1, uint8_t(step.directions | (1u << face))});
+        }
+    }
+    return true;
+}
+
+std::vector<LodChunk> ChunkManager::getLodChunks(const glm::vec3& playerPosition, int viewDistance, const LodRings& rings,
+                                                 const glm::mat4& viewProjectionMatrix) const {
+    int playerChunkX = static_cast<int>(std::floor(playerPosition.x / CHUNK_SIZE));
+    int playerChunkZ = static_cast<int>(std::floor(playerPosition.z / CHUNK_SIZE));
+
+    std::vector<LodChunk> lodChunks;
+    for (const auto& [key, chunk] : savedChunks) {
+        int ring = std::max(std::abs(key.x - playerChunkX), std::abs(key.z - playerChunkZ));
+        if (ring <= viewDistance || ring > rings.distance) continue;
+        lodChunks.push_back({chunk, rings.levelAt(ring, viewDistance)});
+    }
+    cullToFrustum(lodChunks, Frustum::fromMatrix(viewProjectionMatrix), [](const LodChunk& lodChunk) { return lodChunk.chunk; });
+    return lodChunks;
+}
+
+template <typename T, typename ChunkOf>
+void ChunkManager::cullToFrustum(std::vector<T>& items, const Frustum& frustum, ChunkOf chunkOf) {
+    // Box around the sections that hold any blocks, padded by a block for the
+    // mesher's corner offset and LOD skirts. Chunks that are all air have nothing to draw.
+    BoxBatch boxes;
+    std::vector<uint8_t> visible;
+    boxes.clear();
+    size_t kept = 0;
+    for (size_t i = 0; i < items.size(); ++i) {
+        const Chunk* chunk = chunkOf(items[i]);
+        int lowest = CHUNK_SECTIONS, highest = -1;
+        for (int s = 0; s < CHUNK_SECTIONS; ++s) {
+            if (chunk->section(s).isEmpty()) continue;
+            lowest = std::min(lowest, s);
+            highest = s;
+        }
+        if (highest < 0) continue;
+        glm::vec3 min = chunk->position + glm::vec3(0.0f, lowest * SECTION_HEIGHT, 0.0f) - glm::vec3(1.0f);
+        glm::vec3 max = chunk->position + glm::vec3(CHUNK_SIZE, (highest + 1) * SECTION_HEIGHT, CHUNK_SIZE) + glm::vec3(1.0f);
+        boxes.push(min, max);
+        items[kept++] = items[i];
+    }
+    items.resize(kept);
+
+    frustum.cull(boxes, visible);
+    kept = 0;
+    for (size_t i = 0; i < items.size(); ++i) {
+        if (visible[i]) items[kept++] = items[i];
+    }
+    items.resize(kept);
+}
+
 std::optional<glm::vec3> ChunkManager::getTargetBlock(const glm::vec3& playerPosition, const glm::vec3& viewDirection) {
     // Normalize the view direction
     glm::vec3 rayDir = glm::normalize(viewDirection);
@@ -1022,10 +1113,10 @@ std::optional<glm::vec3> ChunkManager::getTargetBlock(const glm::vec3& playerPos
         glm::ivec3 blockPos = glm::floor(currentPos);
 
         // Get the block at this position
-        const Voxel* block = getBlockAt(blockPos);
+        int blockType = getBlockTypeAt(blockPos);
 
         // Check if the block is non-empty
-        if (block && block->type != 0 && block->type != 9) {
+        if (blockType > 0 && blockType != 9) {
             return blockPos; // Return the world position of the target block
         }
     }
@@ -1034,20 +1125,17 @@ std::optional<glm::vec3> ChunkManager::getTargetBlock(const glm::vec3& playerPos
     return std::nullopt;
 }
 
-const std::unordered_map<ChunkKey, Chunk, ChunkKeyHasher> ChunkManager::getAllChunks() const {
-    // Create a combined map to hold all chunks
-    std::unordered_map<ChunkKey, Chunk, ChunkKeyHasher> allChunks;
+std::vector<const Chunk*> ChunkManager::getAllChunks() const {
+    // Loaded and saved chunks never share a key, so no deduplication is needed
+    std::vector<const Chunk*> allChunks;
+    allChunks.reserve(chunks.size() + savedChunks.size());
 
-    // Add loaded chunks
     for (const auto& [key, chunk] : chunks) {
-        allChunks[key] = chunk;
+        allChunks.push_back(chunk);
     }
 
-    // Add saved (unloaded) chunks
     for (const auto& [key, chunk] : savedChunks) {
-        if (allChunks.find(key) == allChunks.end()) {
-            allChunks[key] = chunk; // Add only if not already in allChunks
-        }
+        allChunks.push_back(chunk);
     }
     return allChunks;
 }
@@ -0,0 +1,80 @@
+#include "chunkMeshCache.hpp"
+#include <algorithm>
+#include <cstdlib>
+#include <utility>
+
+void ChunkMeshCache::invalidate(const ChunkKey& key) {
+    static const int offsets[5][2] = {{0, 0}, {1, 0}, {-1, 0}, {0, 1}, {0, -1}};
+    for (const auto& offset : offsets) {
+        auto it = entries.find({key.x + offset[0], key.z + offset[1]});
+        if (it != entries.end()) {
+            it->second.stale = true;
+        }
+    }
+}
+
+void ChunkMeshCache::request(CachedChunkMesh& entry, const Chunk* chunk, const VisibilityMasks::Neighbours& neighbours, int lod) {
+    // Loading or unloading a neighbour changes which border faces are hidden
+    bool neighboursChanged = neighbours.px != entry.neighbours.px || neighbours.nx != entry.neighbours.nx ||
+                             neighbours.pz != entry.neighbours.pz || neighbours.nz != entry.neighbours.nz;
+    if (!entry.stale && entry.chunk == chunk && entry.lod == lod && !neighboursChanged) return;
+
+    entry.chunk = chunk;
+    entry.neighbours = neighbours;
+    entry.lod = lod;
+    entry.stale = false;
+    entry.ticket = ++nextTicket;
+    workers.submit({entry.ticket, builtMode, lod, ChunkSnapshot::capture(*chunk, neighbours)});
+}
+
+void ChunkMeshCache::evictOutside(const ChunkKey& center, int radius) {
+    for (auto it = entries.begin(); it != entries.end();) {
+        if (std::max(std::abs(it->first.x - center.x), std::abs(it->first.z - center.z)) > radius) {
+            it = entries.erase(it);
+            countsStale = true;
+        } else {
+            ++it;
+        }
+    }
+}
+
+size_t ChunkMeshCache::update(const ChunkManager& chunkManager, const std::vector<Chunk*>& chunks,
+                              const std::vector<LodChunk>& lodChunks) {
+    // A different meshing mode invalidates everything
+    if (mesher.mode != builtMode) {
+        for (auto& [key, entry] : entries) entry.stale = true;
+        builtMode = mesher.mode;
+    }
+
+    for (const Chunk* chunk : chunks) {
+        request(entries[chunk->key], chunk, chunkManager.getNeighbours(*chunk), 0);
+    }
+    // Downsampled meshes put skirts on every border instead of looking at neighbours
+    for (const LodChunk& lodChunk : lodChunks) {
+        request(entries[lodChunk.chunk->key], lodChunk.chunk, {}, lodChunk.lod);
+    }
+
+    // Install finished meshes that still answer the latest request of a loaded chunk
+    size_t installed = 0;
+    for (ChunkMeshWorkers::Result& result : workers.collect()) {
+        auto it = entries.find(result.key);
+        if (it == entries.end() || it->second.ticket != result.ticket) continue;
+        it->second.mesh = std::move(result.mesh);
+        ++it->second.revision;
+        ++installed;
+    }
+
+    // Turning the camera only changes which chunks are requested, so the totals stay valid
+    if (installed == 0 && !countsStale) return 0;
+    countsStale = false;
+    totalFaces = totalDraws = 0;
+    largestDraw = 0;
+    for (const auto& [key, entry] : entries) {
+        totalFaces += entry.mesh.faces.size();
+        totalDraws += entry.mesh.groups.size();
+        for (const ChunkMesh::Group& group : entry.mesh.groups) {
+            largestDraw = std::max(largestDraw, group.faceCount);
+        }
+    }
+    return installed;
+}
@@ -0,0 +1,64 @@
+#include "chunkMeshWorkers.hpp"
+#include <utility>
+
+ChunkMeshWorkers::ChunkMeshWorkers(const ChunkMesher& mesher, unsigned threadCount) : mesher(mesher) {
+    threads.reserve(threadCount);
+    for (unsigned i = 0; i < threadCount; ++i) {
+        threads.emplace_back(&ChunkMeshWorkers::run, this);
+    }
+}
+
+ChunkMeshWorkers::~ChunkMeshWorkers() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+        jobs.clear();
+    }
+    jobReady.notify_all();
+    for (std::thread& thread : threads) {
+        thread.join();
+    }
+}
+
+void ChunkMeshWorkers::submit(Job job) {
+    if (threads.empty()) {
+        ChunkMesh mesh = mesher.build(job.snapshot, job.mode, job.lod);
+        std::lock_guard<std::mutex> lock(mutex);
+        results.push_back({job.snapshot.key, job.ticket, std::move(mesh)});
+        return;
+    }
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        jobs.push_back(std::move(job));
+    }
+    jobReady.notify_one();
+}
+
+std::vector<ChunkMeshWorkers::Result> ChunkMeshWorkers::collect() {
+    std::lock_guard<std::mutex> lock(mutex);
+    return std::exchange(results, {});
+}
+
+size_t ChunkMeshWorkers::pending() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return jobs.size() + busy + results.size();
+}
+
+void ChunkMeshWorkers::run() {
+    std::unique_lock<std::mutex> lock(mutex);
+    while (true) {
+        jobReady.wait(lock, [&] { return stopping || !jobs.empty(); });
+        if (stopping) return;
+
+        Job job = std::move(jobs.front());
+        jobs.pop_front();
+        ++busy;
+        lock.unlock();
+
+        ChunkMesh mesh = mesher.build(job.snapshot, job.mode, job.lod);
+
+        lock.lock();
+        results.push_back({job.snapshot.key, job.ticket, std::move(mesh)});
+        --busy;
+    }
+}
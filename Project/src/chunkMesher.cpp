@@ -0,0 +1,540 @@
+#include "chunkMesher.hpp"
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+
+namespace {
+// Normal axis and the two in-plane axes (width, height) of each face
+struct FaceAxes {
+    int normal, width, height;
+};
+constexpr FaceAxes FACE_AXES[6] = {
+    {0, 2, 1}, {0, 2, 1}, {1, 0, 2}, {1, 0, 2}, {2, 0, 1}, {2, 0, 1}
+};
+constexpr int AXIS_SIZE[3] = {CHUNK_SIZE, CHUNK_SIZE_Y, CHUNK_SIZE};
+
+const glm::vec3 FACE_NORMALS[6] = {
+    {1, 0, 0}, {-1, 0, 0}, {0, 1, 0}, {0, -1, 0}, {0, 0, 1}, {0, 0, -1}
+};
+
+int faceOfNormal(const glm::vec3& normal) {
+    for (int face = 0; face < 6; ++face) {
+        if (glm::dot(normal, FACE_NORMALS[face]) > 0.9f) return face;
+    }
+    return -1;
+}
+}
+
+ChunkMesher::ChunkMesher(const tga::Obj& cubeModel) {
+    const auto& vertexBuffer = cubeModel.vertexBuffer;
+    const auto& indexBuffer = cubeModel.indexBuffer;
+
+    // Split the cube into its six faces by normal, remapping indices to 0..3 per face
+    glm::vec3 cubeMax(-1e9f);
+    cubeMin = glm::vec3(1e9f);
+    for (int face = 0; face < 6; ++face) {
+        std::vector<uint32_t> localIndex(vertexBuffer.size(), UINT32_MAX);
+        std::array<uint32_t, INDICES_PER_FACE> indices;
+        uint32_t vertexCount = 0;
+        uint32_t indexCount = 0;
+
+        for (size_t tri = 0; tri + 2 < indexBuffer.size(); tri += 3) {
+            if (faceOfNormal(vertexBuffer[indexBuffer[tri]].normal) != face) continue;
+
+            for (size_t k = 0; k < 3; ++k) {
+                uint32_t v = indexBuffer[tri + k];
+                if (localIndex[v] == UINT32_MAX) {
+                    if (vertexCount == VERTICES_PER_FACE) {
+                        throw std::runtime_error("Cube model face has more than 4 vertices");
+                    }
+                    localIndex[v] = vertexCount;
+                    templates[face].vertices[vertexCount++] = vertexBuffer[v];
+                }
+                if (indexCount == INDICES_PER_FACE) {
+                    throw std::runtime_error("Cube model face has more than 2 triangles");
+                }
+                indices[indexCount++] = localIndex[v];
+            }
+        }
+
+        if (vertexCount != VERTICES_PER_FACE || indexCount != INDICES_PER_FACE) {
+            throw std::runtime_error("Cube model is missing a face");
+        }
+        reorderToQuadIndices(templates[face], indices);
+        for (const tga::Vertex& vertex : templates[face].vertices) {
+            cubeMin = glm::min(cubeMin, vertex.position);
+            cubeMax = glm::max(cubeMax, vertex.position);
+        }
+    }
+
+    // Packed vertices store integer corners, so the model has to be one voxel wide
+    glm::vec3 extent = cubeMax - cubeMin;
+    if (std::abs(extent.x - 1.0f) > 1e-3f || std::abs(extent.y - 1.0f) > 1e-3f || std::abs(extent.z - 1.0f) > 1e-3f) {
+        throw std::runtime_error("Cube model is not a unit cube");
+    }
+
+    // Re-express every face's UVs relative to its atlas tile
+    const glm::vec2 tileSize(TILE_SIZE_U, TILE_SIZE_V);
+    for (int face = 0; face < 6; ++face) {
+        FaceTemplate& faceTemplate = templates[face];
+        glm::vec2 tileMin(1.0f), tileMax(0.0f);
+        for (const tga::Vertex& vertex : faceTemplate.vertices) {
+            tileMin = glm::min(tileMin, vertex.uv);
+            tileMax = glm::max(tileMax, vertex.uv);
+        }
+        glm::vec2 extent = tileMax - tileMin;
+        if (std::abs(extent.x - tileSize.x) > 1e-3f || std::abs(extent.y - tileSize.y) > 1e-3f) {
+            throw std::runtime_error("Cube model face tile does not match ChunkMesher::TILE_SIZE");
+        }
+        faceTemplate.tileOrigin = tileMin;
+        for (uint32_t i = 0; i < VERTICES_PER_FACE; ++i) {
+            tga::Vertex& vertex = faceTemplate.vertices[i];
+            vertex.uv = glm::round((vertex.uv - tileMin) / tileSize);
+            faceTemplate.corners[i] = glm::ivec3(glm::round(vertex.position - cubeMin));
+        }
+
+        // Find which uv component changes when stepping along the quad's width
+        const FaceAxes& axes = FACE_AXES[face];
+        faceTemplate.widthUVAxis = 0;
+        for (uint32_t a = 0; a < VERTICES_PER_FACE; ++a) {
+            for (uint32_t b = 0; b < VERTICES_PER_FACE; ++b) {
+                const glm::ivec3& ca = faceTemplate.corners[a];
+                const glm::ivec3& cb = faceTemplate.corners[b];
+                if (ca[axes.height] == cb[axes.height] && ca[axes.width] != cb[axes.width]) {
+                    faceTemplate.widthUVAxis = faceTemplate.vertices[a].uv.x != faceTemplate.vertices[b].uv.x ? 0 : 1;
+                }
+            }
+        }
+    }
+}
+
+void ChunkMesher::reorderToQuadIndices(FaceTemplate& faceTemplate, const std::array<uint32_t, INDICES_PER_FACE>& indices) {
+    // Same triangle when the corners match up to rotation, which keeps the winding
+    auto sameTriangle = [](const uint32_t* a, const uint32_t* b) {
+        for (int r = 0; r < 3; ++r) {
+            if (a[0] == b[r] && a[1] == b[(r + 1) % 3] && a[2] == b[(r + 2) % 3]) return true;
+        }
+        return false;
+    };
+
+    // Try every vertex order until the model's triangles read as QUAD_INDICES
+    std::array<uint32_t, VERTICES_PER_FACE> order = {0, 1, 2, 3};
+    do {
+        uint32_t quad[INDICES_PER_FACE];
+        for (uint32_t i = 0; i < INDICES_PER_FACE; ++i) {
+            quad[i] = order[QUAD_INDICES[i]];
+        }
+        if ((sameTriangle(quad, &indices[0]) && sameTriangle(quad + 3, &indices[3])) ||
+            (sameTriangle(quad, &indices[3]) && sameTriangle(quad + 3, &indices[0]))) {
+            std::array<tga::Vertex, VERTICES_PER_FACE> vertices = faceTemplate.vertices;
+            for (uint32_t i = 0; i < VERTICES_PER_FACE; ++i) {
+                faceTemplate.vertices[i] = vertices[order[i]];
+            }
+            return;
+        }
+    } while (std::next_permutation(order.begin(), order.end()));
+
+    throw std::runtime_error("Cube model face is not a quad");
+}
+
+void ChunkMesher::toTiledUVs(tga::Obj& model) const {
+    const glm::vec2 tileSize(TILE_SIZE_U, TILE_SIZE_V);
+    for (tga::Vertex& vertex : model.vertexBuffer) {
+        int face = faceOfNormal(vertex.normal);
+        if (face < 0) continue;
+        glm::vec2 tileOrigin = templates[face].tileOrigin;
+        vertex.uv = glm::round((vertex.uv - tileOrigin) / tileSize);
+        vertex.tangent = glm::vec3(tileOrigin, 0.0f);
+    }
+}
+
+std::array<PackedFaceTemplate, 6> ChunkMesher::packedFaceTemplates() const {
+    std::array<PackedFaceTemplate, 6> packed;
+    for (int face = 0; face < 6; ++face) {
+        const FaceTemplate& faceTemplate = templates[face];
+        packed[face] = {faceTemplate.tileOrigin, 0, static_cast<uint32_t>(faceTemplate.widthUVAxis)};
+        for (uint32_t i = 0; i < VERTICES_PER_FACE; ++i) {
+            const glm::ivec3& corner = faceTemplate.corners[i];
+            const glm::vec2& uv = faceTemplate.vertices[i].uv;
+            uint32_t bits = uint32_t(corner.x) | uint32_t(corner.y) << 1 | uint32_t(corner.z) << 2 |
+                            uint32_t(uv.x) << 3 | uint32_t(uv.y) << 4;
+            packed[face].corners |= bits << (5 * i);
+        }
+    }
+    return packed;
+}
+
+ChunkMesh ChunkMesher::build(const ChunkSnapshot& snapshot, MeshingMode meshingMode, int lod) const {
+    std::vector<FaceQuad> faces;
+    if (lod > 0) {
+        faces = mergeFaces(cullFaces(snapshot.downsampled(std::min(lod, MAX_CHUNK_LOD))));
+    } else {
+        faces = cullFaces(snapshot);
+        if (meshingMode == MeshingMode::Greedy) {
+            faces = mergeFaces(faces);
+        }
+    }
+
+    // Counting sort by render layer, then section, then block type, so each type of a section becomes one draw
+    auto bucket = [](const FaceQuad& face) { return face.y / SECTION_HEIGHT * 256 + face.type; };
+    std::array<uint32_t, CHUNK_SECTIONS * 256> typeCounts{};
+    for (const FaceQuad& face : faces) {
+        typeCounts[bucket(face)]++;
+    }
+
+    ChunkMesh mesh;
+    mesh.faces.resize(faces.size());
+    std::array<uint32_t, CHUNK_SECTIONS * 256> offsets{};
+    uint32_t running = 0;
+    for (int layer = 0; layer < RENDER_LAYER_COUNT; ++layer) {
+        mesh.layers[layer].firstGroup = static_cast<uint32_t>(mesh.groups.size());
+        for (int section = 0; section < CHUNK_SECTIONS; ++section) {
+            for (int type = 0; type < 256; ++type) {
+                int b = section * 256 + type;
+                if (typeCounts[b] == 0 || static_cast<int>(renderLayerOf(type)) != layer) continue;
+                mesh.groups.push_back({static_cast<BlockID>(type), static_cast<uint8_t>(section), running, typeCounts[b]});
+                offsets[b] = running;
+                running += typeCounts[b];
+            }
+        }
+        mesh.layers[layer].groupCount = static_cast<uint32_t>(mesh.groups.size()) - mesh.layers[layer].firstGroup;
+    }
+    for (const FaceQuad& face : faces) {
+        mesh.faces[offsets[bucket(face)]++] = face;
+    }
+
+    // A quad spans its cell plus the merged extent along the face's in-plane axes
+    for (ChunkMesh::Group& group : mesh.groups) {
+        glm::ivec3 min(AXIS_SIZE[0], AXIS_SIZE[1], AXIS_SIZE[2]);
+        glm::ivec3 max(0);
+        for (uint32_t f = group.firstFace; f < group.firstFace + group.faceCount; ++f) {
+            const FaceQuad& face = mesh.faces[f];
+            const FaceAxes& axes = FACE_AXES[face.face];
+            glm::ivec3 origin(face.x, face.y, face.z);
+            glm::ivec3 extent(1);
+            extent[axes.width] = face.width;
+            extent[axes.height] = face.height;
+            min = glm::min(min, origin);
+            max = glm::max(max, origin + extent);
+        }
+        group.boundsMin = min;
+        group.boundsMax = max;
+    }
+    return mesh;
+}
+
+ChunkSnapshot ChunkSnapshot::capture(const Chunk& chunk, const VisibilityMasks::Neighbours& neighbours) {
+    using namespace VisibilityMasks;
+    ChunkSnapshot snapshot;
+    snapshot.key = chunk.key;
+    snapshot.opaque = chunk.opaqueMask();
+    snapshot.hiding = chunk.hidingMask();
+    snapshot.air = chunk.airMask();
+    for (int s = 0; s < CHUNK_SECTIONS; ++s) {
+        snapshot.sections[s] = chunk.section(s);
+    }
+
+    // Only sections that hold water are read
+    constexpr int wordsPerSection = SECTION_VOLUME / 64;
+    for (int w = 0; w < WORD_COUNT; ++w) {
+        if (chunk.fluidCount(w / wordsPerSection) == 0) {
+            w += wordsPerSection - 1;
+            continue;
+        }
+        for (uint64_t bits = chunk.fluidMask()[w]; bits; bits &= bits - 1) {
+            int i = w * 64 + std::countr_zero(bits);
+            int x = i % CHUNK_SIZE;
+            int z = (i / CHUNK_SIZE) % CHUNK_SIZE;
+            int y = i / (CHUNK_SIZE * CHUNK_SIZE);
+            snapshot.waterFaces.push_back(chunk.getMeta(x, y, z).faceMask);
+        }
+    }
+
+    // Keep only the neighbour rows that touch this chunk: x == 0 of +x, x == 15 of -x,
+    // z == 0 of +z and z == 15 of -z
+    constexpr uint64_t FIRST_ROW = 0xFFFFULL;
+    constexpr uint64_t LAST_ROW = 0xFFFFULL << 48;
+    const Chunk* sides[4] = {neighbours.px, neighbours.nx, neighbours.pz, neighbours.nz};
+    for (int side = 0; side < 4; ++side) {
+        if (!sides[side]) continue;
+        snapshot.hasNeighbour[side] = true;
+        const VoxelMask& mask = sides[side]->hidingMask();
+        for (int w = 0; w < WORD_COUNT; ++w) {
+            int row = w % WORDS_PER_LAYER;
+            uint64_t keep = side == 0 ? ROW_FIRST_BITS
+                          : side == 1 ? ROW_LAST_BITS
+                          : side == 2 ? (row == 0 ? FIRST_ROW : 0)
+                                      : (row == WORDS_PER_LAYER - 1 ? LAST_ROW : 0);
+            snapshot.borders[side][w] = mask[w] & keep;
+        }
+    }
+    return snapshot;
+}
+
+ChunkSnapshot ChunkSnapshot::downsampled(int lod) const {
+    const int cell = 1 << lod;
+    const int volume = cell * cell * cell;
+    auto testBit = [](const VoxelMask& mask, int i) { return ((mask[i >> 6] >> (i & 63)) & 1u) != 0; };
+
+    ChunkSnapshot coarse;
+    coarse.key = key;
+    coarse.air.fill(~uint64_t(0));
+    coarse.hasNeighbour.fill(true); // Empty borders: neighbours read as air
+
+    for (int cy = 0; cy < CHUNK_SIZE_Y; cy += cell) {
+        for (int cz = 0; cz < CHUNK_SIZE; cz += cell) {
+            for (int cx = 0; cx < CHUNK_SIZE; cx += cell) {
+                int solid = 0;
+                int water = 0;
+                BlockID top = 0;
+                for (int y = cy; y < cy + cell; ++y) {
+                    for (int z = cz; z < cz + cell; ++z) {
+                        for (int x = cx; x < cx + cell; ++x) {
+                            int i = Chunk::index(x, y, z);
+                            if (testBit(opaque, i)) {
+                                ++solid;
+                                top = getType(x, y, z); // y runs upwards, so the last one is the top
+                            } else if (!testBit(air, i)) {
+                                ++water;
+                            }
+                        }
+                    }
+                }
+
+                BlockID type = 0;
+                if (solid * 2 >= volume) {
+                    type = top;
+                } else if (water > 0 && water >= volume - solid - water) {
+                    type = 9;
+                }
+                if (type == 0) continue;
+
+                for (int y = cy; y < cy + cell; ++y) {
+                    for (int z = cz; z < cz + cell; ++z) {
+                        for (int x = cx; x < cx + cell; ++x) {
+                            int i = Chunk::index(x, y, z);
+                            coarse.sections[i / SECTION_VOLUME].set(i % SECTION_VOLUME, type);
+                            coarse.air[i >> 6] &= ~(uint64_t(1) << (i & 63));
+                            if (isOpaqueType(type)) coarse.opaque[i >> 6] |= uint64_t(1) << (i & 63);
+                            if (hidesNeighbourFaces(type)) coarse.hiding[i >> 6] |= uint64_t(1) << (i & 63);
+                        }
+                    }
+                }
+            }
+        }
+    }
+
+    // Water shows the faces that touch air, including above the chunk and across its borders
+    static const int steps[6][3] = {{1, 0, 0}, {-1, 0, 0}, {0, 1, 0}, {0, -1, 0}, {0, 0, 1}, {0, 0, -1}};
+    for (int w = 0; w < VisibilityMasks::WORD_COUNT; ++w) {
+        for (uint64_t bits = ~coarse.opaque[w] & ~coarse.air[w]; bits; bits &= bits - 1) {
+            int i = w * 64 + std::countr_zero(bits);
+            int x = i % CHUNK_SIZE;
+            int z = (i / CHUNK_SIZE) % CHUNK_SIZE;
+            int y = i / (CHUNK_SIZE * CHUNK_SIZE);
+            uint8_t faceMask = 0;
+            for (int face = 0; face < 6; ++face) {
+                int nx = x + steps[face][0], ny = y + steps[face][1], nz = z + steps[face][2];
+                bool open = ny < 0 ? false
+                          : !Chunk::inBounds(nx, ny, nz) || testBit(coarse.air, Chunk::index(nx, ny, nz));
+                faceMask |= uint8_t(open) << face;
+            }
+            coarse.waterFaces.push_back(faceMask);
+        }
+    }
+    return coarse;
+}
+
+bool ChunkSnapshot::isHiding(int x, int y, int z) const {
+    if (y < 0 || y >= CHUNK_SIZE_Y) return false;
+    const VoxelMask* mask = &hiding;
+    if (x < 0 || x >= CHUNK_SIZE) {
+        if (z < 0 || z >= CHUNK_SIZE) return false;
+        int side = x < 0 ? 1 : 0;
+        if (!hasNeighbour[side]) return false;
+        mask = &borders[side];
+        x = x < 0 ? CHUNK_SIZE - 1 : 0;
+    } else if (z < 0 || z >= CHUNK_SIZE) {
+        int side = z < 0 ? 3 : 2;
+        if (!hasNeighbour[side]) return false;
+        mask = &borders[side];
+        z = z < 0 ? CHUNK_SIZE - 1 : 0;
+    }
+    int i = Chunk::index(x, y, z);
+    return ((*mask)[i >> 6] >> (i & 63)) & 1u;
+}
+
+std::vector<FaceQuad> ChunkMesher::cullFaces(const ChunkSnapshot& snapshot) const {
+    using namespace VisibilityMasks;
+    constexpr uint64_t ALL = ~uint64_t(0);
+    const VoxelMask& opaque = snapshot.opaque;
+    const VoxelMask& air = snapshot.air;
+    const NeighbourMasks neighbours = snapshot.neighbourMasks();
+    size_t nextWater = 0;
+
+    std::vector<FaceQuad> faces;
+
+    auto addFace = [&](int bit, int y, int zBase, int face, BlockID type) {
+        uint8_t x = static_cast<uint8_t>(bit % CHUNK_SIZE);
+        uint8_t z = static_cast<uint8_t>(zBase + bit / CHUNK_SIZE);
+        faces.push_back({x, static_cast<uint8_t>(y), z, static_cast<uint8_t>(face), type, 1, 1,
+                         faceAO(snapshot, x, y, z, face)});
+    };
+
+    for (int w = 0; w < WORD_COUNT; ++w) {
+        uint64_t water = ~opaque[w] & ~air[w];
+        if (opaque[w] == 0 && water == 0) continue; // Only air in these rows
+
+        int y = w / WORDS_PER_LAYER;
+        int zBase = (w % WORDS_PER_LAYER) * (64 / CHUNK_SIZE);
+
+        // Opaque blocks: a face is kept where the neighbour across it is air, water or leaves
+        if (opaque[w] != 0) {
+            auto open = neighbourWords<true>(snapshot.hiding, neighbours, w, ALL);
+            for (int face = 0; face < 6; ++face) {
+                for (uint64_t bits = opaque[w] & open[face]; bits; bits &= bits - 1) {
+                    int bit = std::countr_zero(bits);
+                    int z = zBase + bit / CHUNK_SIZE;
+                    addFace(bit, y, zBase, face, snapshot.getType(bit % CHUNK_SIZE, y, z));
+                }
+            }
+        }
+
+        // Water: only the faces its faceMask marks as touching air
+        for (uint64_t bits = water; bits; bits &= bits - 1) {
+            int bit = std::countr_zero(bits);
+            uint8_t faceMask = snapshot.waterFaces[nextWater++];
+            for (int face = 0; face < 6; ++face) {
+                if (faceMask & (1u << face)) addFace(bit, y, zBase, face, 9);
+            }
+        }
+    }
+
+    return faces;
+}
+
+uint8_t ChunkMesher::faceAO(const ChunkSnapshot& snapshot, int x, int y, int z, int face) const {
+    const FaceAxes& axes = FACE_AXES[face];
+    glm::ivec3 front(x, y, z);
+    front[axes.normal] += (face & 1) ? -1 : 1;
+
+    uint8_t ao = 0;
+    for (uint32_t i = 0; i < VERTICES_PER_FACE; ++i) {
+        // The two edge neighbours and the diagonal one around this corner, in front of the face
+        const glm::ivec3& corner = templates[face].corners[i];
+        glm::ivec3 side1 = front;
+        glm::ivec3 side2 = front;
+        side1[axes.width] += corner[axes.width] ? 1 : -1;
+        side2[axes.height] += corner[axes.height] ? 1 : -1;
+        glm::ivec3 diagonal = side1;
+        diagonal[axes.height] = side2[axes.height];
+
+        bool s1 = snapshot.isHiding(side1.x, side1.y, side1.z);
+        bool s2 = snapshot.isHiding(side2.x, side2.y, side2.z);
+        bool c = snapshot.isHiding(diagonal.x, diagonal.y, diagonal.z);
+        int level = (s1 && s2) ? 0 : 3 - (int(s1) + int(s2) + int(c));
+        ao |= static_cast<uint8_t>(level << (2 * i));
+    }
+    return ao;
+}
+
+std::vector<FaceQuad> ChunkMesher::mergeFaces(const std::vector<FaceQuad>& faces) const {
+    std::vector<FaceQuad> merged;
+    std::vector<uint16_t> slab(CHUNK_VOLUME);
+
+    for (int face = 0; face < 6; ++face) {
+        // Scatter this direction's faces into a voxel grid of block type | ao << 8
+        // (0 = no face), so only faces with the same type and AO merge
+        std::fill(slab.begin(), slab.end(), 0);
+        bool any = false;
+        for (const FaceQuad& quad : faces) {
+            if (quad.face != face) continue;
+            slab[Chunk::index(quad.x, quad.y, quad.z)] = static_cast<uint16_t>(quad.type | quad.ao << 8);
+            any = true;
+        }
+        if (!any) continue;
+
+        const FaceAxes& axes = FACE_AXES[face];
+        const int widthSize = AXIS_SIZE[axes.width];
+        const int heightSize = AXIS_SIZE[axes.height];
+        auto cell = [&](int slice, int u, int v) -> uint16_t& {
+            int pos[3];
+            pos[axes.normal] = slice;
+            pos[axes.width] = u;
+            pos[axes.height] = v;
+            return slab[Chunk::index(pos[0], pos[1], pos[2])];
+        };
+
+        // Per slice, grow each face into the widest run and then the tallest rectangle
+        for (int slice = 0; slice < AXIS_SIZE[axes.normal]; ++slice) {
+            for (int v = 0; v < heightSize; ++v) {
+                for (int u = 0; u < widthSize; ++u) {
+                    uint16_t key = cell(slice, u, v);
+                    if (key == 0) continue;
+
+                    int width = 1;
+                    while (u + width < widthSize && cell(slice, u + width, v) == key) ++width;
+
+                    // Side faces stop at the section border, see ChunkMesh
+                    int heightLimit = axes.height == 1 ? (v / SECTION_HEIGHT + 1) * SECTION_HEIGHT : heightSize;
+                    int height = 1;
+                    for (; v + height < heightLimit; ++height) {
+                        bool rowMatches = true;
+                        for (int k = 0; k < width && rowMatches; ++k) {
+                            rowMatches = cell(slice, u + k, v + height) == key;
+                        }
+                        if (!rowMatches) break;
+                    }
+
+                    for (int dv = 0; dv < height; ++dv) {
+                        for (int du = 0; du < width; ++du) {
+                            cell(slice, u + du, v + dv) = 0;
+                        }
+                    }
+
+                    int pos[3];
+                    pos[axes.normal] = slice;
+                    pos[axes.width] = u;
+                    pos[axes.height] = v;
+                    merged.push_back({static_cast<uint8_t>(pos[0]), static_cast<uint8_t>(pos[1]), static_cast<uint8_t>(pos[2]),
+                                      static_cast<uint8_t>(face), static_cast<BlockID>(key & 0xFF),
+                                      static_cast<uint8_t>(width), static_cast<uint8_t>(height), static_cast<uint8_t>(key >> 8)});
+                }
+            }
+        }
+    }
+    return merged;
+}
+
+void ChunkMesher::emitFace(const FaceQuad& quad, PackedVertex* vertices) const {
+    const FaceTemplate& faceTemplate = templates[quad.face];
+    const FaceAxes& axes = FACE_AXES[quad.face];
+    const glm::ivec3 offset(quad.x, quad.y, quad.z);
+    const uint32_t rotation = quad.flipsDiagonal() ? 1 : 0;
+
+    for (uint32_t i = 0; i < VERTICES_PER_FACE; ++i) {
+        // Stretch the far edges of the unit face over the merged extent and repeat the tile
+        glm::ivec3 corner = faceTemplate.corners[i];
+        corner[axes.width] *= quad.width;
+        corner[axes.height] *= quad.height;
+        corner += offset;
+
+        glm::uvec2 uv(faceTemplate.vertices[i].uv);
+        uv[faceTemplate.widthUVAxis] *= quad.width;
+        uv[1 - faceTemplate.widthUVAxis] *= quad.height;
+
+        // Rotating the vertex order moves the shared diagonal without changing the winding
+        PackedVertex& vertex = vertices[(i + VERTICES_PER_FACE - rotation) % VERTICES_PER_FACE];
+        vertex.position = uint32_t(corner.x) | uint32_t(corner.y) << 5 | uint32_t(corner.z) << 11 |
+                          uint32_t(quad.face) << 16 | uint32_t(quad.aoLevel(i)) << 19;
+        vertex.attributes = uv.x | uv.y << 6 | uint32_t(quad.type) << 12;
+    }
+}
+
+FaceRecord ChunkMesher::packFace(const FaceQuad& quad) {
+    return {
+        uint32_t(quad.x) | uint32_t(quad.y) << 5 | uint32_t(quad.z) << 11 | uint32_t(quad.face) << 16 |
+            uint32_t(quad.ao) << 19 | uint32_t(quad.flipsDiagonal()) << 27,
+        uint32_t(quad.width) | uint32_t(quad.height) << 6 | uint32_t(quad.type) << 12
+    };
+}
@@ -4,17 +4,21 @@
 
 
 void InteractionManager::resolveCollisions(glm::vec3& playerPosition, ChunkManager& chunkManager) {
-    glm::ivec3 testPosition = playerPosition;
+    glm::ivec3 testPosition = glm::floor(playerPosition);
     int groundY = INT_MIN;
 
-    // Find the highest solid block below the player
-    for (int y = testPosition.y - 1; y >= 0; --y) {
-        testPosition.y = y;
-        auto it = chunkManager.combinedChunk.find(testPosition);
-        if (it != chunkManager.combinedChunk.end() && 
-            it->second.type != 0 && it->second.type != 9) {
-            groundY = y;
-            break;
+    const Chunk* chunk = chunkManager.getChunkAt(playerPosition);
+    if (chunk) {
+        int localX = testPosition.x & CHUNK_MASK;
+        int localZ = testPosition.z & CHUNK_MASK;
+
+        // Find the highest solid block below the player, starting at the column's top
+        int startY = std::min(static_cast<int>(playerPosition.y) - 1, chunk->highestSolid(localX, localZ));
+        for (int y = std::min(startY, CHUNK_SIZE_Y - 1); y >= 0; --y) {
+            if (isOpaqueType(chunk->getType(localX, y, localZ))) {
+                groundY = y;
+                break;
+            }
         }
     }
 
@@ -206,7 +210,7 @@ void InteractionManager::handleMovement(ChunkManager& chunkManager, glm::vec3& b
             if (localX < 0) localX += CHUNK_SIZE;
             if (localZ < 0) localZ += CHUNK_SIZE;
             // Check if the player is falling below the current highest block
-            int highestBlockY = TerrainManager::getClosestGroundWithClearance(chunkManager.getChunkAt(playerPosition)->voxels, localX, localZ,playerPosition.y);
+            int highestBlockY = TerrainManager::getClosestGroundWithClearance(*chunkManager.getChunkAt(playerPosition), localX, localZ,playerPosition.y);
 
             if (newPositionY.y < highestBlockY + 1.0f) {
                 playerPosition.y = static_cast<float>(highestBlockY + 1.0f); // Clamp to the highest block's surface
@@ -262,7 +266,7 @@ void InteractionManager::handleMovement(ChunkManager& chunkManager, glm::vec3& b
             if (localX < 0) localX += CHUNK_SIZE;
             if (localZ < 0) localZ += CHUNK_SIZE;
             // Check if the player is falling below the current highest block
-            int highestBlockY = TerrainManager::getClosestGroundWithClearance(chunkManager.getChunkAt(playerPosition)->voxels, localX, localZ,playerPosition.y);
+            int highestBlockY = TerrainManager::getClosestGroundWithClearance(*chunkManager.getChunkAt(playerPosition), localX, localZ,playerPosition.y);
 
             if (newPositionY.y < highestBlockY + 1.0f) {
                 playerPosition.y = static_cast<float>(highestBlockY + 1.0f); // Clamp to the highest block's surface
@@ -291,7 +295,7 @@ bool InteractionManager::isPositionColliding(const glm::vec3& position, const Ch
 
                 auto it = chunkManager.combinedChunk.find(testPosition);
                 if (it != chunkManager.combinedChunk.end()) {
-                    if (it->second.type != 0 && it->second.type != 9) {
+                    if (it->second != 0 && it->second != 9) {
                         return true; // Collision detected (solid block, not water)
                     }
                 }
@@ -59,11 +59,15 @@ int main() {
     for (auto& vertex : cubeModel.vertexBuffer) {
         vertex.position *= scaleFactor;
     }
+    ChunkMesher chunkMesher(cubeModel); // Per-face templates taken from the scaled cube
+    ChunkMeshCache meshCache(chunkMesher); // Meshes dirty chunks on worker threads
+
     scaleFactor = 0.3;
     tga::Obj droppedBlocks = cubeModel;
     for (auto& vertex : droppedBlocks.vertexBuffer) {
         vertex.position *= scaleFactor;
     }
+    chunkMesher.toTiledUVs(droppedBlocks); // fs.frag expects tiled UVs for every block
 
     // Generate a random seed using the current time
     ChunkManager chunkManager;
@@ -74,9 +78,6 @@ int main() {
     int worldWidth = 25;
     int worldDepth = 25;
 
-    size_t maxVoxels = worldWidth * worldDepth * CHUNK_SIZE * CHUNK_SIZE_Y * CHUNK_SIZE;
-    size_t bufferSize = sizeof(Voxel) * maxVoxels;
-
     //////////////////////////////////////////////////////////////////////////////////////////////////////////////////
     auto [camData, camStaging, camSize] = stagingBufferOfType<Camera>(tgai);
     camData.projection = glm::perspective_vk(glm::radians(90.f), static_cast<float>(windowWidth) / windowHeight, 0.1f, 1000.f);
@@ -109,6 +110,18 @@ int main() {
     /*Note: use batched version here*/
     auto geometryVS = tga::loadShader("shaders/vs.spv", tga::ShaderType::vertex, tgai);
     auto geometryFS = tga::loadShader("shaders/fs.spv", tga::ShaderType::fragment, tgai);
+    auto cutoutFS = tga::loadShader("shaders/cutout_frag.spv", tga::ShaderType::fragment, tgai); // Leaves
+    auto translucentFS = tga::loadShader("shaders/translucent_frag.spv", tga::ShaderType::fragment, tgai); // Water
+    auto chunkVS = tga::loadShader("shaders/chunk_vert.spv", tga::ShaderType::vertex, tgai); // Packed chunk vertices
+    auto chunkFacesVS = tga::loadShader("shaders/chunk_faces_vert.spv", tga::ShaderType::vertex, tgai); // Face pulling
+    ChunkRenderMode chunkRenderMode = ChunkRenderMode::PackedVertices;
+
+    // Cube face corners and atlas tiles, looked up by the chunk shaders
+    auto faceTemplates = chunkMesher.packedFaceTemplates();
+    auto faceTemplateStaging = tgai.createStagingBuffer({sizeof(faceTemplates), tga::memoryAccess(faceTemplates)});
+    auto faceTemplateBuffer = tgai.createBuffer({tga::BufferUsage::storage, sizeof(faceTemplates), faceTemplateStaging});
+    tgai.free(faceTemplateStaging);
+    QuadIndexBuffer quadIndices;
 
     // set
     auto geometryInitPass = tgai.createRenderPass(
@@ -221,21 +234,39 @@ int main() {
         {postProcessingPass, {tga::Binding{hdrOutputTex, 0}}, 
                         0 });
 
-    // A Compute Pass to perform the culling
+    // Compute Passes to perform the culling in two phases: phase one lets through the
+    // opaque draws visible last frame, phase two tests everything against the depth
+    // pyramid built from them. Both share one layout.
+    tga::InputLayout cullLayout{tga::SetLayout{tga::BindingType::uniformBuffer, tga::BindingType::storageBuffer,
+                                               tga::BindingType::storageBuffer, tga::BindingType::storageBuffer,
+                                               tga::BindingType::storageBuffer,
+                                               tga::BindingType::uniformBuffer, tga::BindingType::storageBuffer,
+                                               tga::BindingType::storageBuffer, tga::BindingType::uniformBuffer,
+                                               tga::BindingType::storageBuffer, tga::BindingType::storageBuffer}};
     auto cullPass = tgai.createComputePass(
-        {tga::loadShader("shaders/frustum_culling_comp.spv", tga::ShaderType::compute,tgai),
-         tga::InputLayout{tga::SetLayout{tga::BindingType::uniformBuffer, tga::BindingType::storageBuffer,
-                                         tga::BindingType::storageBuffer, tga::BindingType::storageBuffer,
-                                         tga::BindingType::storageBuffer,
-                                         tga::BindingType::uniformBuffer, tga::BindingType::storageBuffer}}
+        {tga::loadShader("shaders/frustum_culling_comp.spv", tga::ShaderType::compute,tgai), cullLayout});
+    auto occlusionPass = tgai.createComputePass(
+        {tga::loadShader("shaders/occlusion_culling_comp.spv", tga::ShaderType::compute,tgai), cullLayout});
+
+    // Depth pyramid for phase two, reduced from the G-buffer
+    auto depthPyramidPass = tgai.createComputePass(
+        {tga::loadShader("shaders/depth_pyramid_comp.spv", tga::ShaderType::compute,tgai),
+         tga::InputLayout{tga::SetLayout{tga::BindingType::uniformBuffer, tga::BindingType::sampler,
+                                         tga::BindingType::sampler, tga::BindingType::storageBuffer,
+                                         tga::BindingType::uniformBuffer}}
         });
+    DepthPyramid depthPyramid;
+    depthPyramid.create(tgai, depthPyramidPass, windowWidth, windowHeight, camBuffer, positionTex, normalTex);
 
-    // The communication path to report how many instances where drawn in total
-    auto numDrawnInstancesStaging = tgai.createStagingBuffer({sizeof(uint32_t)});
-    auto numDrawnInstancesBuffer = tgai.createBuffer({tga::BufferUsage::storage, sizeof(uint32_t)});
+    // The communication path to report how many instances where drawn and culled
+    auto numDrawnInstancesStaging = tgai.createStagingBuffer({sizeof(CullStats)});
+    auto numDrawnInstancesBuffer = tgai.createBuffer({tga::BufferUsage::storage, sizeof(CullStats)});
 
-    auto initBatchRenderData = [&](Batch& batch) {
+    // Chunk batches use the packed formats and additionally bind the face templates,
+    // plus the face records when pulling faces
+    auto initBatchRenderData = [&](Batch& batch, bool chunkBatch) {
         BatchRenderData rdata;
+        bool facePulling = chunkBatch && chunkRenderMode == ChunkRenderMode::FacePulling;
       
         std::vector<tga::Binding> batchBindings{tga::Binding{batch.modelMatrices.buffer, 0},
                                                     tga::Binding{batch.materialIDs.buffer, 1}};
@@ -244,37 +275,77 @@ int main() {
             batchBindings.push_back({batch.textures[i], 2, static_cast<uint32_t>(i)});
         }
 
-        rdata.geometryPass = tgai.createRenderPass(
-            tga::RenderPassInfo{geometryVS, geometryFS, std::vector<tga::Texture>{albedoTex, normalTex, positionTex}}
-                .setClearOperations(tga::ClearOperation::none)
-                .setPerPixelOperations(
-                tga::PerPixelOperations{}
-                    .setBlendEnabled(true)
+        tga::SetLayout batchLayout{tga::BindingType::storageBuffer,
+                                   tga::BindingType::storageBuffer,
+                                   {tga::BindingType::sampler, static_cast<uint32_t>(batch.textures.size())}};
+        if (facePulling) {
+            batchLayout = tga::SetLayout{tga::BindingType::storageBuffer,
+                                         tga::BindingType::storageBuffer,
+                                         {tga::BindingType::sampler, static_cast<uint32_t>(batch.textures.size())},
+                                         tga::BindingType::storageBuffer,
+                                         tga::BindingType::storageBuffer};
+            batchBindings.push_back({faceTemplateBuffer, 3});
+            batchBindings.push_back({batch.faces.buffer, 4});
+        } else if (chunkBatch) {
+            batchLayout = tga::SetLayout{tga::BindingType::storageBuffer,
+                                         tga::BindingType::storageBuffer,
+                                         {tga::BindingType::sampler, static_cast<uint32_t>(batch.textures.size())},
+                                         tga::BindingType::storageBuffer};
+            batchBindings.push_back({faceTemplateBuffer, 3});
+        }
+
+        tga::Shader vertexShader = geometryVS;
+        tga::VertexLayout vertexLayout = tga::Vertex::layout();
+        if (facePulling) {
+            vertexShader = chunkFacesVS;
+            vertexLayout = {}; // Corners are generated from gl_VertexIndex
+        } else if (chunkBatch) {
+            vertexShader = chunkVS;
+            vertexLayout = PackedVertex::layout();
+        }
+
+        // Opaque and alpha-tested geometry is written without blending; only the
+        // translucent layer blends over what is already in the G-buffer
+        int layerCount = chunkBatch ? RENDER_LAYER_COUNT : 1;
+        for (int layer = 0; layer < layerCount; ++layer) {
+            bool translucent = layer == static_cast<int>(RenderLayer::Translucent);
+            tga::Shader fragmentShader = geometryFS;
+            if (layer == static_cast<int>(RenderLayer::AlphaTested)) fragmentShader = cutoutFS;
+            if (translucent) fragmentShader = translucentFS;
+
+            tga::PerPixelOperations perPixel = tga::PerPixelOperations{}.setDepthCompareOp(tga::CompareOperation::lessEqual);
+            if (translucent) {
+                perPixel.setBlendEnabled(true)
                     .setSrcBlend(tga::BlendFactor::srcAlpha)
-                    .setDstBlend(tga::BlendFactor::oneMinusSrcAlpha)
-            )
-                .setVertexLayout(tga::Vertex::layout())
-                .setInputLayout(
-                    {tga::SetLayout{tga::BindingType::uniformBuffer},
-                    /*Note: Set size of batches */
-                    tga::SetLayout{tga::BindingType::storageBuffer,                    
-                                    tga::BindingType::storageBuffer,
-                                    {tga::BindingType::sampler, static_cast<uint32_t>(batch.textures.size())}}}));
-
-        rdata.geometryInput = tgai.createInputSet({rdata.geometryPass, batchBindings, 1});
-
-        // provide the number of objects in this batch
-        auto elementCountStaging =
-            tgai.createStagingBuffer({sizeof(uint32_t), tga::memoryAccess(batch.drawCommands.count)});
-        rdata.elementCount = tgai.createBuffer({tga::BufferUsage::uniform, sizeof(uint32_t), elementCountStaging});
-        tgai.free(elementCountStaging);
-
-        rdata.cullInput = tgai.createInputSet(
-            {cullPass,
-            {tga::Binding{camBuffer, 0}, tga::Binding{batch.modelMatrices.buffer, 1},
+                    .setDstBlend(tga::BlendFactor::oneMinusSrcAlpha);
+            }
+
+            rdata.geometryPasses[layer] = tgai.createRenderPass(
+                tga::RenderPassInfo{vertexShader, fragmentShader, std::vector<tga::Texture>{albedoTex, normalTex, positionTex}}
+                    .setClearOperations(tga::ClearOperation::none)
+                    .setPerPixelOperations(perPixel)
+                    .setVertexLayout(vertexLayout)
+                    .setInputLayout(
+                        {tga::SetLayout{tga::BindingType::uniformBuffer},
+                        /*Note: Set size of batches */
+                        batchLayout}));
+
+            rdata.geometryInputs[layer] = tgai.createInputSet({rdata.geometryPasses[layer], batchBindings, 1});
+        }
+
+        // provide the number of objects in this batch, uploaded as CullBounds every frame
+        rdata.elementCount = tgai.createBuffer({tga::BufferUsage::uniform, sizeof(CullBounds)});
+        if (!chunkBatch) return rdata;
+
+        std::vector<tga::Binding> cullBindings{
+            tga::Binding{camBuffer, 0}, tga::Binding{batch.modelMatrices.buffer, 1},
             tga::Binding{batch.boundingBoxes.buffer, 2}, tga::Binding{batch.drawCommands.buffer, 3},
-            tga::Binding{batch.materialIDs.buffer,4},
-            tga::Binding{rdata.elementCount, 5}, tga::Binding(numDrawnInstancesBuffer, 6)}});
+            tga::Binding{batch.visibility.buffer, 4},
+            tga::Binding{rdata.elementCount, 5}, tga::Binding(numDrawnInstancesBuffer, 6),
+            tga::Binding{depthPyramid.texels, 7}, tga::Binding{depthPyramid.levelTable, 8},
+            tga::Binding{batch.compactedDraws.buffer, 9}, tga::Binding{batch.lateDraws.buffer, 10}};
+        rdata.cullInput = tgai.createInputSet({cullPass, cullBindings});
+        rdata.occlusionInput = tgai.createInputSet({occlusionPass, cullBindings});
 
         return rdata;
     };
@@ -288,11 +359,16 @@ int main() {
     
     std::cout << "Start position is: ( " << playerPosition.x << ", " << playerPosition.y << ", " << playerPosition.z << ")\n";
 
-    Batch batch;
+    ChunkGpuStore chunkStore;
+    Batch& batch = chunkStore.batch; // Persistent chunk buffers
     BatchRenderData renderData;
+    ChunkKey lastCameraChunk{std::numeric_limits<int>::max(), 0}; // Forces the first sort
+    bool compactedValid = false; // batch.compactedDraws matches the current draw list
+    std::vector<Chunk*> lastDrawnChunks; // Chunks in view at the last batch update
+    SectionMasks lastVisibleSections; // Sections of those chunks the camera can see into
 
-    Batch minedBatch;
-    BatchRenderData minedRenderData;
+    EntityInstanceBuffer entities; // Dropped blocks, TNT and the sun
+    BatchRenderData entityRenderData;
 
     tga::CommandBuffer cmd;
     
@@ -301,6 +377,7 @@ int main() {
     std::string currentSaveFileName;
     std::string saveFileName = "moreDiamonds";
     int viewDistance = 1; // Render chunks within "x" chunks of the player
+    LodRings lodRings;    // Downsampled chunks beyond viewDistance
     int distanceTimer = 0;
     glm::vec3 sunPosition = glm::vec3(0, 100, 0);
     float sunRadius = 200.0f;
@@ -317,7 +394,7 @@ int main() {
         std::cout << "Random Seed is: " << randomSeed << "\n";
         PerlinNoise perlin(randomSeed);
         chunkManager.generateWorld(worldWidth, worldDepth, perlin);
-        playerPosition.y = TerrainManager::getHighestBlock(chunkManager.getChunkAt(playerPosition)->voxels, 0, 0) + 2.f;
+        playerPosition.y = TerrainManager::getHighestBlock(*chunkManager.getChunkAt(playerPosition), 0, 0) + 2.f;
     }
     
     // Set the player's initial position
@@ -326,7 +403,7 @@ int main() {
 
     bool gameRunning = false;
     std::string newWorldName;
-    auto& lastNumDrawnElements = *static_cast<uint32_t*>(tgai.getMapping(numDrawnInstancesStaging));
+    auto& lastCullStats = *static_cast<CullStats*>(tgai.getMapping(numDrawnInstancesStaging));
 
     // Render loop
     for (uint32_t frame{0}; !tgai.windowShouldClose(window); ++frame) {
@@ -338,7 +415,7 @@ int main() {
             return -1; // Exit the game to the menu
         }
         
-        handleOptions(window,  tgai, cullTimer, enableCull, viewDistance, distanceTimer, camData);
+        handleOptions(window,  tgai, cullTimer, enableCull, viewDistance, lodRings, distanceTimer, camData, chunkMesher, chunkManager, chunkRenderMode);
 
         auto nextFrame = tgai.nextFrame(window);
         tga::CommandRecorder rec{tgai, cmd};
@@ -379,19 +456,13 @@ int main() {
         glm::vec3 cameraPosition = player.getPosition() + glm::vec3(-0.5f,1.7,-0.5f);
         player.update(chunkManager, dt, tgai, window, blockWorldPos, cameraPosition, centerX, centerY, blockType, lookTimer);
         chunkManager.updateMinedBlocks(dt, player.getPosition(), player.collectedBlocks);
-        std::vector<MinedBlock> minedBlocks = chunkManager.getMinedBlocks();
-        if (minedBatch.vertex.buffer) {
-                minedBatch.destroy(tgai);
+        if (entities.update(tgai, rec, droppedBlocks, chunkManager.getMinedBlocks(), sunPosition, sunRadius)) {
+            if (entityRenderData.elementCount) {
+                entityRenderData.destroy(tgai);
             }
-        if (minedRenderData.geometryPass) {
-            minedRenderData.destroy(tgai);
-        }
-        if (minedBlocks.size() > 0) {
-            minedBatch = generateVoxelBatchMined(droppedBlocks, minedBlocks, tgai, player.getPosition(), viewDistance, sunPosition, sunRadius);
-            rec.bufferUpload(minedBatch.materialIDs.staging, minedBatch.materialIDs.buffer, minedBatch.materialIDs.count * sizeof(uint32_t));
-            rec.barrier(tga::PipelineStage::Transfer, tga::PipelineStage::VertexInput);
-            minedRenderData = initBatchRenderData(minedBatch);
+            entityRenderData = initBatchRenderData(entities.batch, false);
         }
+        rec.barrier(tga::PipelineStage::Transfer, tga::PipelineStage::DrawIndirect);
         auto currentTime = std::chrono::steady_clock::now();
         float debug = std::chrono::duration<float>(currentTime - debugTime).count();
 
@@ -431,34 +502,53 @@ int main() {
         chunkManager.updateChunks(viewProjectionMatrix, cameraPosition, viewDistance);
         currentTime = std::chrono::steady_clock::now();
         debug = std::chrono::duration<float>(currentTime - debugTime).count();
-        std::vector<Chunk*> visibleChunks = chunkManager.getVisibleChunks(player.getPosition(), viewDistance,viewProjectionMatrix );
+        SectionMasks visibleSections;
+        std::vector<Chunk*> visibleChunks = chunkManager.getVisibleChunks(cameraPosition, viewDistance, viewProjectionMatrix, visibleSections);
        //std::cout << "Time for chunks update: " << debug << ", For chunks: " << visibleChunks.size() << "\n";
-
-        //if visuals needs updating
-        if (chunkManager.shouldUpdate()) {
-            debugTime = std::chrono::steady_clock::now();
+        // Chunks past the simulated area are drawn from downsampled meshes
+        std::vector<LodChunk> lodChunks = chunkManager.getLodChunks(player.getPosition(), viewDistance, lodRings, viewProjectionMatrix);
+        std::vector<Chunk*> drawnChunks = visibleChunks;
+        for (const LodChunk& lodChunk : lodChunks) {
+            drawnChunks.push_back(lodChunk.chunk);
+        }
+        // Turning the camera changes the draw list without changing any chunk
+        bool drawnChunksChanged = drawnChunks != lastDrawnChunks || visibleSections != lastVisibleSections;
+        lastDrawnChunks = drawnChunks;
+        lastVisibleSections = std::move(visibleSections);
+
+        // Translucent chunks are sorted by distance, so crossing into another chunk reorders them
+        ChunkKey cameraChunk = {static_cast<int>(std::floor(cameraPosition.x)) >> CHUNK_SHIFT,
+                                static_cast<int>(std::floor(cameraPosition.z)) >> CHUNK_SHIFT};
+        bool cameraChunkChanged = !(cameraChunk == lastCameraChunk);
+        lastCameraChunk = cameraChunk;
+
+        //if visuals needs updating, or meshes from the workers are still arriving
+        bool drawListRewritten = chunkManager.shouldUpdate() || meshCache.hasPending() || cameraChunkChanged || drawnChunksChanged;
+        if (drawListRewritten) {
             // Get visible chunks
         
             //std::cout << "Visible chunks: " << visibleChunks.size() << "\n";
-            if (batch.vertex.buffer) {
-                batch.destroy(tgai);
+            // Re-mesh only the chunks that changed and rewrite just their ranges of the chunk store
+            for (const ChunkKey& key : chunkManager.dirtyChunks) {
+                meshCache.invalidate(key);
             }
-            // Regenerate batch only if chunks are updated
-            batch = generateVoxelBatch(cubeModel, visibleChunks, tgai, player.getPosition(), viewDistance);
-            currentTime = std::chrono::steady_clock::now();
-            debug = std::chrono::duration<float>(currentTime - debugTime).count();
-            std::cout << "Time for Batch update: " << debug << ", For chunks: " << visibleChunks.size() << "\n";
-            debugTime = std::chrono::steady_clock::now();
-            //updateVoxelBatch(batch, cubeModel, visibleChunks, tgai);
-            rec.bufferUpload(batch.materialIDs.staging, batch.materialIDs.buffer, batch.materialIDs.count * sizeof(uint32_t));
-            if (renderData.geometryPass) {
-                renderData.destroy(tgai);
+            chunkManager.dirtyChunks.clear();
+            // Meshes of chunks out of view stay cached until they leave the drawn area
+            ChunkKey playerChunk = {static_cast<int>(std::floor(player.getPosition().x / CHUNK_SIZE)),
+                                    static_cast<int>(std::floor(player.getPosition().z / CHUNK_SIZE))};
+            meshCache.evictOutside(playerChunk, std::max(viewDistance, lodRings.distance));
+            meshCache.update(chunkManager, visibleChunks, lodChunks);
+            bool buffersRecreated = chunkStore.update(tgai, rec, chunkMesher, meshCache, drawnChunks, lastVisibleSections, chunkRenderMode, cameraPosition);
+            quadIndices.reserve(tgai, meshCache.maxDrawQuads());
+            // Input sets only change when a buffer had to grow or the render mode switched
+            if (buffersRecreated || !renderData.elementCount) {
+                if (renderData.elementCount) {
+                    renderData.destroy(tgai);
+                }
+                renderData = initBatchRenderData(batch, true);
             }
-            renderData = initBatchRenderData(batch);
-            currentTime = std::chrono::steady_clock::now();
-            debug = std::chrono::duration<float>(currentTime - debugTime).count();
-
-            std::cout << "Time for renderData update: " << debug << ", For chunks: " << visibleChunks.size() << "\n";
+            compactedValid = false; // Draw indices changed
+            rec.barrier(tga::PipelineStage::Transfer, tga::PipelineStage::DrawIndirect);
         } 
 
         // Constants
@@ -493,8 +583,22 @@ int main() {
 
         sunPosition = player.getPosition() + sunlight.direction * circleHeight;
 
-        // Reset the drawn instance count
-        const uint32_t zero{0};
+        // The submitted draw counts have to be known here, and TGA has no draw with a count taken
+        // from a buffer. So phase one uses the compacted list of last frame when the draw list
+        // did not change since; the previous frame has finished, so its read back count is exact.
+        const uint32_t opaqueCount = chunkStore.layerDraws[static_cast<int>(RenderLayer::Opaque)].count;
+        const uint32_t alphaTestedCount = chunkStore.layerDraws[static_cast<int>(RenderLayer::AlphaTested)].count;
+        uint32_t compactedDraws = compactedValid ? lastCullStats.compacted : 0;
+        // Phase two only adds opaque draws that phase one skipped, which are those not visible
+        // last frame. A rewritten list starts out all visible, so then there are none.
+        uint32_t lateOpaqueSlots = drawListRewritten ? 0 : opaqueCount - compactedDraws;
+        if (renderData.elementCount) {
+            CullBounds cullBounds{batch.drawCommands.count, opaqueCount, alphaTestedCount, compactedDraws, lateOpaqueSlots};
+            rec.inlineBufferUpdate(renderData.elementCount, &cullBounds, sizeof(cullBounds));
+        }
+
+        // Reset the cull counters
+        const CullStats zero{};
         rec.inlineBufferUpdate(numDrawnInstancesBuffer, &zero, sizeof(zero));
 
         // Barrier to ensure uploads are finished before the compute pass
@@ -506,23 +610,29 @@ int main() {
 
         auto debugTimeRendering = std::chrono::steady_clock::now();
 
-        //
-        if(enableCull){
-        // Compute pass: frustum culling
+        // Occlusion culling needs the chunk batch's cull input sets
+        bool occlusionCull = enableCull && renderData.cullInput;
+        constexpr uint32_t workGroupSize{64}; // local_size_x of the cull shaders
+        if(occlusionCull){
+        // Compute pass: phase one, the opaque draws visible last frame that are still in the frustum.
+        // The same threads clear the late lists.
+        uint32_t phaseOneThreads = std::max({compactedDraws ? compactedDraws : opaqueCount, lateOpaqueSlots, alphaTestedCount});
         rec.setComputePass(cullPass);
         rec.bindInputSet(renderData.cullInput);
-        constexpr uint32_t workGroupSize{128};
-        rec.dispatch((batch.drawCommands.count + workGroupSize - 1) / workGroupSize, 1, 1);
+        rec.dispatch((phaseOneThreads + workGroupSize - 1) / workGroupSize, 1, 1);
         // Barrier to ensure culling is finished before rendering
-        rec.barrier(tga::PipelineStage::ComputeShader, tga::PipelineStage::Transfer);
-        rec.bufferDownload(numDrawnInstancesBuffer, numDrawnInstancesStaging, sizeof(uint32_t));
-        rec.barrier(tga::PipelineStage::ComputeShader, tga::PipelineStage::VertexInput);
-        posStream << "Drawn Instances: " << lastNumDrawnElements << ",   " << std::to_string((frame % 256) / smoothedTime) << ",         POS: X = " << player.getPosition().x << ", Y = " << player.getPosition().y << ", Z = " << player.getPosition().z 
+        rec.barrier(tga::PipelineStage::ComputeShader, tga::PipelineStage::DrawIndirect);
+        posStream << "Drawn: " << lastCullStats.drawn << ", Frustum culled: " << lastCullStats.frustumCulled
+        << ", Occluded: " << lastCullStats.occlusionCulled << ", Submitted early: " << compactedDraws << ", late: " << lateOpaqueSlots << ",   " << std::to_string((frame % 256) / smoothedTime) << ",         POS: X = " << player.getPosition().x << ", Y = " << player.getPosition().y << ", Z = " << player.getPosition().z 
         << ",             VIEW: X " << forward.x << " Z = " << forward.z;
         } else {
         posStream << std::to_string((frame % 256) / smoothedTime) << ",         POS: X = " << player.getPosition().x << ", Y = " << player.getPosition().y << ", Z = " << player.getPosition().z 
         << ",             VIEW: X " << forward.x << " Z = " << forward.z;
         }
+        // Occupancy of the chunk geometry heap; many free blocks with a high fragmentation mean a regrow is near
+        const RangeAllocator& heap = chunkStore.heap();
+        posStream << ",   HEAP: " << heap.usedUnits() << "/" << heap.capacity() << " faces, " << heap.freeBlockCount()
+        << " free blocks, fragmentation " << heap.fragmentation() << ", last upload " << chunkStore.uploadedBytes() / 1024 << " KiB";
         auto currentTimeRendering = std::chrono::steady_clock::now();
         debug = std::chrono::duration<float>(currentTimeRendering - debugTimeRendering).count();
 
@@ -530,17 +640,58 @@ int main() {
       
         debugTimeRendering = std::chrono::steady_clock::now();
         // 1. G-Buffer Geometry Pass
-        rec.setRenderPass(geometryInitPass, 0)
+        // The init pass only clears the G-buffer, every layer then draws with its own pipeline
+        rec.setRenderPass(geometryInitPass, 0);
+        // Draws count commands of a layer, starting at command first of the given list
+        auto drawChunks = [&](RenderLayer layer, tga::Buffer commands, uint32_t count, uint32_t first) {
+            if (count == 0) return;
+            rec.setRenderPass(renderData.geometryPasses[static_cast<int>(layer)], 0)
+            .bindInputSet(geometryCamInput);
+            if (batch.vertex.buffer) {
+                rec.bindVertexBuffer(batch.vertex.buffer); // Face pulling batches have no vertex buffer
+            }
+            rec.bindIndexBuffer(quadIndices.buffer);
+            rec.bindInputSet(renderData.geometryInputs[static_cast<int>(layer)]);
+            rec.drawIndexedIndirect(commands, count, first * sizeof(tga::DrawIndexedIndirectCommand));
+        };
+        auto drawChunkLayer = [&](RenderLayer layer) {
+            const ChunkGpuStore::DrawRange& draws = chunkStore.layerDraws[static_cast<int>(layer)];
+            drawChunks(layer, batch.drawCommands.buffer, draws.count, draws.first);
+        };
+
+        if (occlusionCull && compactedDraws) {
+            // Only the commands that survived last frame's occlusion test
+            drawChunks(RenderLayer::Opaque, batch.compactedDraws.buffer, compactedDraws, 0);
+        } else {
+            drawChunkLayer(RenderLayer::Opaque);
+        }
+        if(occlusionCull){
+        // Compute pass: phase two, depth pyramid from the opaque terrain drawn so far, then
+        // every draw is tested against it. Only draws phase one skipped are let through.
+        // The barrier also keeps phase two from rewriting compacted commands still being read.
+        rec.barrier(tga::PipelineStage::ColorAttachmentOutput, tga::PipelineStage::ComputeShader);
+        depthPyramid.build(rec, depthPyramidPass);
+        rec.setComputePass(occlusionPass);
+        rec.bindInputSet(renderData.occlusionInput);
+        rec.dispatch((batch.drawCommands.count + workGroupSize - 1) / workGroupSize, 1, 1);
+        rec.barrier(tga::PipelineStage::ComputeShader, tga::PipelineStage::Transfer);
+        rec.bufferDownload(numDrawnInstancesBuffer, numDrawnInstancesStaging, sizeof(CullStats));
+        rec.barrier(tga::PipelineStage::ComputeShader, tga::PipelineStage::DrawIndirect);
+        drawChunks(RenderLayer::Opaque, batch.lateDraws.buffer, lateOpaqueSlots, 0); // Terrain that came into view this frame
+        }
+        compactedValid = occlusionCull;
+        rec.setRenderPass(entityRenderData.geometryPasses[static_cast<int>(RenderLayer::Opaque)], 0)
         .bindInputSet(geometryCamInput);
-        rec.bindVertexBuffer(batch.vertex.buffer).bindIndexBuffer(batch.index.buffer);
-        rec.bindInputSet(renderData.geometryInput);
-        rec.drawIndexedIndirect(batch.drawCommands.buffer, batch.drawCommands.count);
-
-        if(minedBlocks.size() > 0){
-            rec.bindVertexBuffer(minedBatch.vertex.buffer).bindIndexBuffer(minedBatch.index.buffer);
-            rec.bindInputSet(minedRenderData.geometryInput);
-            rec.drawIndexedIndirect(minedBatch.drawCommands.buffer, minedBatch.drawCommands.count);
+        rec.bindVertexBuffer(entities.batch.vertex.buffer).bindIndexBuffer(entities.batch.index.buffer);
+        rec.bindInputSet(entityRenderData.geometryInputs[static_cast<int>(RenderLayer::Opaque)]);
+        rec.drawIndexedIndirect(entities.batch.drawCommands.buffer, entities.batch.drawCommands.count);
+        if (occlusionCull) {
+            // Unused slots of the late list keep an instance count of 0
+            drawChunks(RenderLayer::AlphaTested, batch.lateDraws.buffer, alphaTestedCount, opaqueCount);
+        } else {
+            drawChunkLayer(RenderLayer::AlphaTested);
         }
+        drawChunkLayer(RenderLayer::Translucent); // Keeps its back to front order, culled draws have 0 instances
         currentTimeRendering = std::chrono::steady_clock::now();
         debug = std::chrono::duration<float>(currentTimeRendering - debugTimeRendering).count();
 
@@ -32,7 +32,7 @@ void Player::update(ChunkManager& chunkManager, float dt, tga::Interface& tgai,
         glm::ivec3 playerBlockPos = glm::floor(position);
         auto waterCheck = chunkManager.combinedChunk.find(playerBlockPos);
         if (waterCheck != chunkManager.combinedChunk.end() && 
-            (waterCheck->second.type == 9)) {
+            (waterCheck->second == 9)) {
             inWater = true;
         }
 
@@ -56,40 +56,30 @@ void TerrainManager::generateTerrain(Chunk& chunk, int chunkX, int chunkZ, Perli
             // Generate terrain column
             for (int y = 0; y < CHUNK_SIZE_Y; ++y) {
                 if (y == 0) {
-                    chunk.voxels[x][y][z].type = 3;  // Bedrock
-                    chunk.voxels[x][y][z].sourceID = -1;
+                    chunk.setType(x, y, z, 3);  // Bedrock
                 } else if (y < height - 3) {
-                    chunk.voxels[x][y][z].type = 2;  // Stone
-                    chunk.voxels[x][y][z].sourceID = -1;
+                    chunk.setType(x, y, z, 2);  // Stone
                 } else if (y < height) {
                     double blendNoise = perlin.noise(worldX * 0.1, y * 0.1, worldZ * 0.1);
                     if (biome == Desert) {
-                        chunk.voxels[x][y][z].type = 8;  // Sand
-                        chunk.voxels[x][y][z].sourceID = -1;
+                        chunk.setType(x, y, z, 8);  // Sand
                     } else if (biome == Grassland) {
-                        chunk.voxels[x][y][z].type = 1;  // Grass
-                        chunk.voxels[x][y][z].sourceID = -1;
+                        chunk.setType(x, y, z, 1);  // Grass
                     } else if (biome == Mountain) {
                         if (y < height - 5) {
-                            chunk.voxels[x][y][z].type = (blendNoise > 0.5) ? 2 : 7;  // stone and Cobblestone
-                            chunk.voxels[x][y][z].sourceID = -1;
+                            chunk.setType(x, y, z, (blendNoise > 0.5) ? 2 : 7);  // stone and Cobblestone
                         } else if (y < height - 1) {
-                            chunk.voxels[x][y][z].type = (blendNoise > 0.3) ? 1 : 2;  // Grass and ston
-                            chunk.voxels[x][y][z].sourceID = -1;
+                            chunk.setType(x, y, z, (blendNoise > 0.3) ? 1 : 2);  // Grass and ston
                         } else if (y == height - 1 && y > waterLevel + 15) {
-                            chunk.voxels[x][y][z].type = 10;  // Snow
-                            chunk.voxels[x][y][z].sourceID = -1;
+                            chunk.setType(x, y, z, 10);  // Snow
                         }
                     }
                 } else if (y <= waterLevel) {
-                    chunk.voxels[x][y][z].type = 9;  // Water
-                    chunk.voxels[x][y][z].isSource = true;
-                    chunk.voxels[x][y][z].sourceID = -1;
+                    chunk.setType(x, y, z, 9);  // Water
                 } else {
-                    chunk.voxels[x][y][z].type = 0;  // Air
-                    chunk.voxels[x][y][z].sourceID = -1;
+                    chunk.setType(x, y, z, 0);  // Air
                 }
-                chunk.voxels[x][y][z].visible = false;
+                chunk.setVisible(x, y, z, false);
             }
 
             // Add caves
@@ -97,9 +87,8 @@ void TerrainManager::generateTerrain(Chunk& chunk, int chunkX, int chunkZ, Perli
                 double caveNoise = perlin.noise(worldX * 0.1, y * 0.1, worldZ * 0.1) +
                                    perlin.noise(worldX * 0.05, y * 0.05, worldZ * 0.05) * 0.5;
                 if (caveNoise > 0.6) {
-                    chunk.voxels[x][y][z].type = 0;  // Carve out caves
-                    chunk.voxels[x][y][z].visible = false;
-                    chunk.voxels[x][y][z].sourceID = -1;
+                    chunk.setType(x, y, z, 0);  // Carve out caves
+                    chunk.setVisible(x, y, z, false);
                 }
             }
 
@@ -107,24 +96,20 @@ void TerrainManager::generateTerrain(Chunk& chunk, int chunkX, int chunkZ, Perli
             for (int y = 2; y < height - 5; ++y) {
                 double oreNoise = perlin.noise(worldX * 0.15, y * 0.15, worldZ * 0.15);
 
-                if (oreNoise > 0.72 && chunk.voxels[x][y][z].type == 2 && y < height - 20) {  // Rare chance at low depth
-                    chunk.voxels[x][y][z].type = 4;  // Diamond
-                    chunk.voxels[x][y][z].sourceID = -1;
-                    chunk.voxels[x][y][z].visible = true;
-                } else  if (oreNoise > 0.60 && oreNoise <= 0.72 && chunk.voxels[x][y][z].type == 2 && y < height - 10 && !isMineralNearby(chunk, x, y, z, 2, 14)) {  // Rare chance
-                    chunk.voxels[x][y][z].type = 14;  // gold
-                    chunk.voxels[x][y][z].sourceID = -1;
-                    chunk.voxels[x][y][z].visible = true;
+                if (oreNoise > 0.72 && chunk.getType(x, y, z) == 2 && y < height - 20) {  // Rare chance at low depth
+                    chunk.setType(x, y, z, 4);  // Diamond
+                    chunk.setVisible(x, y, z, true);
+                } else  if (oreNoise > 0.60 && oreNoise <= 0.72 && chunk.getType(x, y, z) == 2 && y < height - 10 && !isMineralNearby(chunk, x, y, z, 2, 14)) {  // Rare chance
+                    chunk.setType(x, y, z, 14);  // gold
+                    chunk.setVisible(x, y, z, true);
                     continue;
-                } else  if (oreNoise > 0.53 && oreNoise <= 0.60 && chunk.voxels[x][y][z].type == 2 && !isMineralNearby(chunk, x, y, z, 2, 14)) {  // Rare chance
-                    chunk.voxels[x][y][z].type = 12;  // iron
-                    chunk.voxels[x][y][z].sourceID = -1;
-                    chunk.voxels[x][y][z].visible = true;
+                } else  if (oreNoise > 0.53 && oreNoise <= 0.60 && chunk.getType(x, y, z) == 2 && !isMineralNearby(chunk, x, y, z, 2, 14)) {  // Rare chance
+                    chunk.setType(x, y, z, 12);  // iron
+                    chunk.setVisible(x, y, z, true);
                     continue;
-                } else  if (oreNoise > 0.45 && oreNoise <= 0.53 && chunk.voxels[x][y][z].type == 2 && !isMineralNearby(chunk, x, y, z, 1, 12)) {  // Rare chance
-                    chunk.voxels[x][y][z].type = 13;  // coal
-                    chunk.voxels[x][y][z].sourceID = -1;
-                    chunk.voxels[x][y][z].visible = true;
+                } else  if (oreNoise > 0.45 && oreNoise <= 0.53 && chunk.getType(x, y, z) == 2 && !isMineralNearby(chunk, x, y, z, 1, 12)) {  // Rare chance
+                    chunk.setType(x, y, z, 13);  // coal
+                    chunk.setVisible(x, y, z, true);
                 }
             }
 
@@ -133,9 +118,8 @@ void TerrainManager::generateTerrain(Chunk& chunk, int chunkX, int chunkZ, Perli
                 int treeHeight = 5 + (gen() % 3);  // Tree height between 5 and 7
                 for (int h = 0; h < treeHeight; ++h) {
                     if (height + h >= CHUNK_SIZE_Y) break;
-                    chunk.voxels[x][height + h][z].type = 5;  // Wood
-                    chunk.voxels[x][height + h][z].visible = true;
-                    chunk.voxels[x][height + h][z].sourceID = -1;
+                    chunk.setType(x, height + h, z, 5);  // Wood
+                    chunk.setVisible(x, height + h, z, true);
                 }
 
                 // Add leaves in a spherical pattern
@@ -150,9 +134,8 @@ void TerrainManager::generateTerrain(Chunk& chunk, int chunkX, int chunkZ, Perli
                             if (nx >= 0 && nx < CHUNK_SIZE && ny >= 0 && ny < CHUNK_SIZE_Y && nz >= 0 && nz < CHUNK_SIZE) {
                                 float dist = std::sqrt(lx * lx + lz * lz + ly * ly);
                                 if (dist <= leafRadius && randomChance(gen) < 0.8) {
-                                    chunk.voxels[nx][ny][nz].type = 6;  // Leaves
-                                    chunk.voxels[nx][ny][nz].visible = true;
-                                    chunk.voxels[nx][ny][nz].sourceID = -1;
+                                    chunk.setType(nx, ny, nz, 6);  // Leaves
+                                    chunk.setVisible(nx, ny, nz, true);
                                 }
                             }
                         }
@@ -161,20 +144,10 @@ void TerrainManager::generateTerrain(Chunk& chunk, int chunkX, int chunkZ, Perli
             }
         }
     }
-    // Determine visibility for all voxels in the chunk
-    for (int x = 0; x < CHUNK_SIZE; ++x) {
-        for (int y = 0; y < CHUNK_SIZE_Y; ++y) {
-            for (int z = 0; z < CHUNK_SIZE; ++z) {
-                if (chunk.voxels[x][y][z].type != 0) { // Only check non-air blocks
-                    if(chunk.voxels[x][y][z].type == 4 || chunk.voxels[x][y][z].type == 14){
-                        chunk.voxels[x][y][z].visible = true;
-                    } else {
-                    chunk.voxels[x][y][z].visible = isExposed(chunk, x, y, z);
-                    }
-                }
-            }
-        }
-    }
+    chunk.optimizeSections();
+
+    // Neighbouring chunks may not exist yet, so chunk borders start out hidden
+    calculateVisibility(chunk);
     chunk.isGenerated = true;
 }
 
@@ -191,7 +164,7 @@ bool TerrainManager::isMineralNearby(const Chunk& chunk, int x, int y, int z, in
                     ny >= 0 && ny < CHUNK_SIZE_Y &&
                     nz >= 0 && nz < CHUNK_SIZE) {
                     // Check if there's a different mineral
-                    int neighborType = chunk.voxels[nx][ny][nz].type;
+                    int neighborType = chunk.getType(nx, ny, nz);
                     if (neighborType != 0 && neighborType != 2 && neighborType != currentMineralType) {
                         return true; // Found a different mineral nearby
                     }
@@ -202,51 +175,29 @@ bool TerrainManager::isMineralNearby(const Chunk& chunk, int x, int y, int z, in
     return false; // No conflicting minerals found
 }
 
-bool TerrainManager::isExposed(const Chunk& chunk, int x, int y, int z) {
-    // Check neighboring voxels for exposure
-    constexpr int neighbors[6][3] = {
-        {-1, 0, 0}, {1, 0, 0}, {0, -1, 0}, {0, 1, 0}, {0, 0, -1}, {0, 0, 1}
-    };
-
-    for (const auto& offset : neighbors) {
-        int nx = x + offset[0];
-        int ny = y + offset[1];
-        int nz = z + offset[2];
-
-        // Ensure neighbor is within chunk bounds
-        if (nx >= 0 && nx < CHUNK_SIZE && ny >= 0 && ny < CHUNK_SIZE_Y && nz >= 0 && nz < CHUNK_SIZE) {
-            if (chunk.voxels[nx][ny][nz].type == 0 || chunk.voxels[x][y][z].type == 9) {
-                return true; // Block is exposed if neighbor is air
-            }
-        }
-    }
+void TerrainManager::calculateVisibility(Chunk& chunk) {
+    VisibilityMasks::update(chunk, {});
+}
 
-    return false; // Not exposed
+int TerrainManager::getHighestBlock(const Chunk& chunk, int x, int z) {
+    int y = chunk.highestSolid(x, z);
+    return y >= 0 ? y : 20; // Default to the highest point if no blocks are present
 }
 
-int TerrainManager::getHighestBlock(const Voxel voxels[CHUNK_SIZE][CHUNK_SIZE_Y][CHUNK_SIZE], int x, int z) {
-    for (int y = CHUNK_SIZE_Y - 1; y >= 0; --y) {
-        if (voxels[x][y][z].type != 0 && voxels[x][y][z].type != 9) { // Check for a non-empty block
-            return y;
-        }
+int TerrainManager::getClosestGroundWithClearance(const Chunk& chunk, int localX, int localZ, int playerY) {
+    // The heightmap answers directly whenever the player is above the topmost clear ground
+    int top = chunk.highestClearGround(localX, localZ);
+    if (top <= playerY) {
+        return top; // -1 if no suitable ground level exists
     }
-    return 20; // Default to the highest point if no blocks are present
-}
 
-int TerrainManager::getClosestGroundWithClearance(const Voxel voxels[CHUNK_SIZE][CHUNK_SIZE_Y][CHUNK_SIZE], int localX, int localZ, int playerY) {
-    // Start from the player's Y position and search downward
-    for (int y = playerY; y >= 0; --y) {
-        // Check if this is a solid block
-        if (voxels[localX][y][localZ].type != 0 && voxels[localX][y][localZ].type != 9) {
-            // Ensure there are at least two air blocks above it for clearance
-            if (y + 1 < CHUNK_SIZE_Y && y + 2 < CHUNK_SIZE_Y &&
-                voxels[localX][y + 1][localZ].type == 0 &&
-                voxels[localX][y + 2][localZ].type == 0) {
-                return y; // Return this Y level as the ground level
-            }
+    // Player is below an overhang: search downward from the player's Y position
+    for (int y = std::min(playerY, top - 1); y >= 0; --y) {
+        if (chunk.isClearGround(localX, y, localZ)) {
+            return y; // Return this Y level as the ground level
         }
     }
 
     // If no suitable ground level is found, return -1
     return -1;
-}
\ No newline at end of file
+}